@@ -1,12 +1,20 @@
 #include "dungeon_map.h"
 #include "dungeon_map_mesh_builder.h"
+#include "dungeon_map_parallel.h"
 
+#include <os/os.h>
 #include <print_string.h>
+#include <scene/resources/concave_polygon_shape.h>
 #include <servers/physics_server.h>
 
+#include <string.h>
+
+// Rows of the wall distance passes run per apply step.
+static const int WALL_DISTANCE_STEP_ROWS = 32;
+
 void DungeonMap::apply()
 {
-    if (!is_inside_tree()) {
+    if (!is_inside_tree() || generating || applying) {
         return;
     }
 
@@ -14,48 +22,268 @@ void DungeonMap::apply()
         return;
     }
 
-    // Clear the previous data.
-    clear();
+    // Without double buffering the current level goes away while the next one builds.
+    if (!double_buffered) {
+        clear();
+    }
 
-    _build_regions();
-    _update_tile_neighbors();
-    _build_region_meshes();
-    _build_region_mesh_edges();
+    // Rebuilding the current layout starts a new set of stats.
+    if (!next_level_generated) {
+        stats.reset();
+    }
+    _prepare_next_level();
+    _analyze_connectivity();
 
-    // Update all regions as not dirty.
-    for (Map<Vector2, Region*>::Element* e = regions.front(); e; e = e->next()) {
-        Region* region = e->get();
-        region->dirty = false;
+    // Run every phase now, or spread them over the idle frames.
+    _begin_apply(GENERATION_PHASE_TILES);
+    if (!incremental_apply) {
+        _apply_step(0);
+    }
+}
+
+void DungeonMap::_begin_apply(GenerationPhase phase)
+{
+    applying = true;
+    _set_apply_phase(phase);
+    set_process_internal(incremental_apply);
+}
+
+void DungeonMap::_set_apply_phase(GenerationPhase phase)
+{
+    apply_phase = phase;
+    apply_index = 0;
+
+    if (phase < MAX_GENERATION_PHASES) {
+        _report_progress(phase, 0.0f);
+    }
+}
+
+bool DungeonMap::_apply_step(uint64_t budget_usec)
+{
+    uint64_t start = OS::get_singleton()->get_ticks_usec();
+
+    while (applying) {
+        switch (apply_phase) {
+            case GENERATION_PHASE_TILES: {
+                // The level's own region count, the setters may have changed the map's since.
+                int regions_per_side = next_level->regions_per_side;
+                if (apply_index >= regions_per_side * regions_per_side) {
+                    _set_apply_phase(GENERATION_PHASE_NEIGHBORS);
+                    continue;
+                }
+                _build_region(apply_index / regions_per_side, apply_index % regions_per_side);
+            } break;
+
+            case GENERATION_PHASE_NEIGHBORS: {
+                // A single pass over the grid, cheap enough to run in one step.
+                _update_tile_neighbors();
+                _set_apply_phase(GENERATION_PHASE_WALL_DISTANCE);
+                continue;
+            } break;
+
+            case GENERATION_PHASE_WALL_DISTANCE: {
+                // Both chamfer passes run in bands of rows, each step resumes the build.
+                DungeonMapScopedTimer timer(_get_stat_counter(DungeonMapStats::STAGE_WALL_DISTANCE));
+                DungeonMapPathFinder::Grid grid = _get_path_grid(next_level);
+                if (apply_index == 0) {
+                    next_level->wall_distance.begin_build(grid);
+                }
+                if (next_level->wall_distance.build_step(grid, WALL_DISTANCE_STEP_ROWS)) {
+                    _set_apply_phase(GENERATION_PHASE_MESHES);
+                    continue;
+                }
+            } break;
+
+            case GENERATION_PHASE_MESHES:
+            case GENERATION_PHASE_EDGES:
+            case GENERATION_PHASE_COMMIT: {
+                // Without a time budget the meshes are built on every core at once.
+                if (budget_usec == 0 && apply_phase != GENERATION_PHASE_COMMIT) {
+                    if (apply_phase == GENERATION_PHASE_MESHES) {
+                        _build_region_meshes();
+                    } else {
+                        _build_region_mesh_edges();
+                    }
+                    _set_apply_phase((GenerationPhase)(apply_phase + 1));
+                    continue;
+                }
+
+                if (apply_index >= next_level->regions.size()) {
+                    _set_apply_phase((GenerationPhase)(apply_phase + 1));
+                    continue;
+                }
+
+                Region* region = next_level->regions[apply_index];
+                if (apply_phase == GENERATION_PHASE_MESHES) {
+                    DungeonMapScopedTimer timer(_get_stat_counter(DungeonMapStats::STAGE_FLOOR_MESH));
+                    _build_region_mesh(region);
+                } else if (apply_phase == GENERATION_PHASE_EDGES) {
+                    DungeonMapScopedTimer timer(_get_stat_counter(DungeonMapStats::STAGE_EDGE_MESH));
+                    _build_region_mesh_edge(region);
+                } else {
+                    _commit_region(region);
+                }
+            } break;
+
+            default: {
+                _finish_apply();
+                return true;
+            } break;
+        }
+        apply_index++;
+
+        // Continue on the next frame once we're out of time.
+        if (budget_usec > 0 && OS::get_singleton()->get_ticks_usec() - start >= budget_usec) {
+            break;
+        }
+    }
+
+    if (applying) {
+        int total = next_level->regions.size();
+        if (apply_phase == GENERATION_PHASE_TILES) {
+            total = next_level->regions_per_side * next_level->regions_per_side;
+        } else if (apply_phase == GENERATION_PHASE_WALL_DISTANCE) {
+            total = (next_level->tile_height * 2 + WALL_DISTANCE_STEP_ROWS - 1) / WALL_DISTANCE_STEP_ROWS;
+        }
+        _report_progress(apply_phase, total > 0 ? (float)apply_index / total : 1.0f);
     }
-    dirty = false;
+    return !applying;
+}
 
-    // Attempt to apply the nav mesh.
-    // Node* node = get_parent()->get_node(NodePath("Navigation"));
-    // if (navigation_node) {
-    //     add_navigation_meshes(navigation_node);
-    // }
+void DungeonMap::_finish_apply()
+{
+    applying = false;
+    set_process_internal(false);
+
+    _swap_levels();
+    dirty = edited_during_apply;
+    edited_during_apply = false;
+
+    if (stats_enabled) {
+        stats.tile_bytes = level->tile_types.size() * sizeof(uint8_t) +
+                level->tile_heights.size() * sizeof(int16_t) +
+                level->tile_neighbors.size() * sizeof(uint8_t) +
+                level->valid_tiles.size() * sizeof(int) +
+                level->map_builder.get_grid().get_memory_usage() +
+                level->connectivity.get_memory_usage() +
+                level->wall_distance.get_memory_usage();
+        // The tile grid only has storage of its own once islands were pruned from it.
+        if (level->pruned_tile_count > 0) {
+            stats.tile_bytes += level->tile_grid.get_memory_usage();
+        }
+        stats.region_bytes = level->regions.get_capacity() * sizeof(Region);
+    }
 
     emit_signal("dungeon_map_apply_completed");
 }
 
-void DungeonMap::clear()
+void DungeonMap::_prepare_next_level()
 {
-    valid_tiles.clear();
-    for (Map<Vector2, Tile*>::Element* e = tiles.front(); e; e = e->next()) {
-        Tile* tile = e->get();
-		memdelete(tile);
-	}
-    tiles.clear();
+    _clear_level(next_level);
+
+    // Rebuild from the current layout when no new one was generated.
+    if (!next_level_generated) {
+        next_level->map_builder = level->map_builder;
+        next_level->rng = level->rng;
+    }
+    next_level_rebuilds_layout = !next_level_generated;
+    next_level_generated = false;
+
+    int map_width = region_size * tiles_per_region;
+    next_level->regions_per_side = region_size;
+    next_level->tiles_per_region = tiles_per_region;
+    next_level->resize_tiles(map_width, map_width, params.floor_size);
+
+    next_level->seed = params.seed;
+    next_level->merge_floor_tiles = merge_floor_tiles;
+    next_level->merge_wall_edges = merge_wall_edges;
+    next_level->prune_islands = prune_islands;
+    next_level->ceiling_height = ceiling_height;
+    next_level->wall_slant = wall_slant;
+}
+
+void DungeonMap::_swap_levels()
+{
+    // Everything for the next level was built up front, so the new instances,
+    // collision and navigation meshes replace the old ones within this frame.
+    level_lock->write_lock();
+    Level* previous = level;
+    level = next_level;
+    next_level = previous;
+    flow_field.clear();
+    path_queue_field.clear();
+    path_hierarchy.reset(level->tile_width, level->tile_height, level->tiles_per_region);
+    level_lock->write_unlock();
+    entity_hash.reset(level->tile_width, level->tile_height, level->tiles_per_region, level->tile_size);
+
+    for (int i = 0; i < level->regions.size(); i++) {
+        Region* region = level->regions[i];
+        _activate_region(region);
+        region->dirty = false;
+    }
+    _clear_level(next_level);
+}
+
+void DungeonMap::_activate_region(Region* region)
+{
+    if (region->instance.is_valid()) {
+        VS::get_singleton()->instance_set_visible(region->instance, is_visible());
+    }
+    if (region->edge_instance.is_valid()) {
+        VS::get_singleton()->instance_set_visible(region->edge_instance, is_visible());
+    }
 
-    // Attempt to remove the nav meshes.
-    if (navigation_node) {
-        remove_navigation_meshes(navigation_node);
+    if (region->collision_body && !region->collision_body->is_inside_tree()) {
+        add_child(region->collision_body);
+        region->collision_body->set_owner(this);
     }
+    if (region->edge_collision_body && !region->edge_collision_body->is_inside_tree()) {
+        add_child(region->edge_collision_body);
+        region->edge_collision_body->set_owner(this);
+    }
+
+    if (navigation_node && region->nav_mesh.is_valid() && region->nav_mesh_id == 0) {
+        region->nav_mesh_id = ((Navigation*)(navigation_node))->navmesh_add(region->nav_mesh, region->transform, navigation_node);
+    }
+}
+
+void DungeonMap::clear()
+{
+    // Stop any apply that's still in progress. The generation thread
+    // owns the next level, so leave it alone while generating.
+    if (applying) {
+        applying = false;
+        set_process_internal(false);
+    }
+    if (!generating) {
+        _clear_level(next_level);
+    }
+
+    level_lock->write_lock();
+    _clear_level(level);
+    flow_field.clear();
+    path_queue_field.clear();
+    path_hierarchy.reset(0, 0, tiles_per_region);
+    level_lock->write_unlock();
+    entity_hash.reset(0, 0, tiles_per_region, 0.0f);
     navigation_node = NULL;
+    edited_during_apply = false;
+    dirty = true;
+}
 
-    // Delete all regions in our dictionary.
-    for (Map<Vector2, Region*>::Element* e = regions.front(); e; e = e->next()) {
-        Region* region = e->get();
+void DungeonMap::_clear_level(Level* p_level)
+{
+    p_level->clear_tiles();
+
+    // Release the resources of every region.
+    for (int i = 0; i < p_level->regions.size(); i++) {
+        Region* region = p_level->regions[i];
+
+        // Remove the nav mesh from the navigation node.
+        if (navigation_node && region->nav_mesh_id != 0) {
+            ((Navigation*)(navigation_node))->navmesh_remove(region->nav_mesh_id);
+            region->nav_mesh_id = 0;
+        }
 
         // Free meshes.
         if (region->mesh.is_valid()) {
@@ -74,82 +302,301 @@ void DungeonMap::clear()
             VS::get_singleton()->free(region->edge_instance);
         }
 
-        // Delete collision.
-        if (region->collision_shape) {
-            region->collision_shape->queue_delete();
-        }
+        // Delete collision (the shapes are children of the bodies).
         if (region->collision_body) {
-            // region->collision_body->set_owner(NULL);
-            // remove_child(region->collision_body);
-            // PhysicsServer::get_singleton()->free(region->collision_body->get_rid());
-            region->collision_body->queue_delete();
-        }
-
-        if (region->edge_collision_shape) {
-            region->edge_collision_shape->queue_delete();
+            if (region->collision_body->is_inside_tree()) {
+                region->collision_body->queue_delete();
+            } else {
+                memdelete(region->collision_body);
+            }
         }
         if (region->edge_collision_body) {
-            // remove_child(region->edge_collision_body);
-            // region->edge_collision_body->set_owner(NULL);
-            // PhysicsServer::get_singleton()->free(region->edge_collision_body->get_rid());
-            region->edge_collision_body->queue_delete();
-        }
-
-        region->tiles.clear();
-
-        if (region->nav_mesh.is_valid()) {
-            region->nav_mesh.unref();
+            if (region->edge_collision_body->is_inside_tree()) {
+                region->edge_collision_body->queue_delete();
+            } else {
+                memdelete(region->edge_collision_body);
+            }
         }
-        memdelete(region);
 	}
-    regions.clear();
-    dirty = true;
+
+    // Return the regions to the pool in a single reset.
+    p_level->regions.reset();
 }
 
 void DungeonMap::generate_map_image()
 {
-    if (!is_inside_tree()) {
+    if (!is_inside_tree() || generating || applying) {
         return;
     }
 
     // Create the map image/texture.
-    map_builder.params.dungeon_size = region_size * map_builder.params.floor_size * tiles_per_region;
-    print_line(String("Dungeon Size = ") + itos(map_builder.params.dungeon_size));
+    params.dungeon_size = region_size * params.floor_size * tiles_per_region;
+    print_line(String("Dungeon Size = ") + itos(params.dungeon_size));
+
+    // The new layout goes into the next level, apply() swaps it in.
+    stats.reset();
+    {
+        DungeonMapScopedTimer timer(_get_stat_counter(DungeonMapStats::STAGE_WALK));
+        next_level->map_builder.params = params;
+        next_level->map_builder.create_map_image();
+        next_level->map_builder.generate_map_image();
+    }
 
-    map_builder.create_map_image();
-    map_builder.generate_map_image();
+    // Use a separate stream so map queries don't shift the floor walk.
+    next_level->rng.seed((uint64_t)params.seed, 1);
+    next_level_generated = true;
     emit_signal("dungeon_map_image_generated");
 }
 
-DungeonMap::Region* DungeonMap::find_region(const Vector2& region_id)
+void DungeonMap::generate_async()
 {
-    if (!regions.has(region_id)) {
-        return NULL;
+    if (!is_inside_tree() || generating || applying) {
+        return;
+    }
+
+    // Without double buffering the current level goes away while the next one builds.
+    mark_dirty();
+    if (!double_buffered) {
+        clear();
+    }
+    _prepare_next_level();
+    // The thread replaces the copied layout with a new walk.
+    next_level_rebuilds_layout = false;
+
+    params.dungeon_size = region_size * params.floor_size * tiles_per_region;
+    next_level->map_builder.params = params;
+    stats.reset();
+    cancel_requested = false;
+    generating = true;
+    generation_thread = Thread::create(_generation_thread_func, this);
+}
+
+void DungeonMap::cancel_generation()
+{
+    if (!generating) {
+        return;
+    }
+    cancel_requested = true;
+}
+
+void DungeonMap::_generation_thread_func(void* p_userdata)
+{
+    DungeonMap* dungeon_map = (DungeonMap*)p_userdata;
+    dungeon_map->_generate();
+}
+
+void DungeonMap::_generate()
+{
+    // Everything here only touches CPU-side data. Resources owned by servers
+    // and the scene tree are created in _finish_generation.
+    _report_progress(GENERATION_PHASE_WALK, 0.0f);
+    {
+        DungeonMapScopedTimer timer(_get_stat_counter(DungeonMapStats::STAGE_WALK));
+        next_level->map_builder.create_map_image();
+        next_level->map_builder.generate_map_image();
+    }
+    next_level->rng.seed((uint64_t)next_level->seed, 1);
+
+    if (!cancel_requested) {
+        _analyze_connectivity();
+        _report_progress(GENERATION_PHASE_TILES, 0.0f);
+        _build_regions();
+    }
+    if (!cancel_requested) {
+        _report_progress(GENERATION_PHASE_NEIGHBORS, 0.0f);
+        _update_tile_neighbors();
+    }
+    if (!cancel_requested) {
+        _report_progress(GENERATION_PHASE_WALL_DISTANCE, 0.0f);
+        _update_wall_distances();
+    }
+    if (!cancel_requested) {
+        _report_progress(GENERATION_PHASE_MESHES, 0.0f);
+        _build_region_meshes();
     }
-    return regions[region_id];
+    if (!cancel_requested) {
+        _report_progress(GENERATION_PHASE_EDGES, 0.0f);
+        _build_region_mesh_edges();
+    }
+
+    call_deferred("_finish_generation");
+}
+
+void DungeonMap::_finish_generation()
+{
+    if (!generation_thread) {
+        return;
+    }
+    bool canceled = cancel_requested;
+    _wait_for_generation();
+
+    if (canceled || !is_inside_tree()) {
+        _clear_level(next_level);
+        emit_signal("dungeon_map_generation_canceled");
+        return;
+    }
+
+    emit_signal("dungeon_map_image_generated");
+
+    // Commit the regions now, or spread them over the idle frames.
+    _begin_apply(GENERATION_PHASE_COMMIT);
+    if (!incremental_apply) {
+        _apply_step(0);
+    }
+}
+
+void DungeonMap::_wait_for_generation()
+{
+    if (!generation_thread) {
+        return;
+    }
+    Thread::wait_to_finish(generation_thread);
+    memdelete(generation_thread);
+    generation_thread = NULL;
+    generating = false;
+    cancel_requested = false;
+}
+
+void DungeonMap::_report_progress(GenerationPhase phase, float fraction)
+{
+    // Signals must be emitted from the main thread.
+    if (generating) {
+        call_deferred("_emit_generation_progress", (int)phase, fraction);
+    } else {
+        _emit_generation_progress((int)phase, fraction);
+    }
+}
+
+void DungeonMap::_emit_generation_progress(int phase, float fraction)
+{
+    emit_signal("dungeon_map_generation_progress", phase, fraction);
 }
 
-DungeonMap::Tile* DungeonMap::find_tile(const Vector2& tile_id)
+DungeonMap::Region* DungeonMap::Level::find_region(const Vector2& region_id) const
 {
-    if (!tiles.has(tile_id)) {
+    int region_width = tiles_per_region * tile_size;
+    if (region_width <= 0) {
+        return NULL;
+    }
+
+    // Regions are built x-major, so the index follows from the region coordinates.
+    int regions_per_side = tile_height / tiles_per_region;
+    int x = (int)Math::floor(region_id.x / region_width);
+    int y = (int)Math::floor(region_id.y * -1.0f / region_width);
+    if (x < 0 || y < 0 || y >= regions_per_side) {
         return NULL;
     }
-    return tiles[tile_id];
+
+    int index = x * regions_per_side + y;
+    return index < regions.size() ? regions[index] : NULL;
+}
+
+void DungeonMap::Level::set_tile_valid(int index, bool valid)
+{
+    // Regions are built x-major, the same as in find_region.
+    int regions_per_side = tile_height / tiles_per_region;
+    int region_index = (index % tile_width) / tiles_per_region * regions_per_side + (index / tile_width) / tiles_per_region;
+    ERR_FAIL_INDEX(region_index, regions.size());
+
+    Region* region = regions[region_index];
+    int* tiles = valid_tiles.ptrw();
+    int end = region->tile_start + region->tile_count;
+    int delta = 0;
+
+    if (valid) {
+        ERR_FAIL_COND(valid_tile_count >= valid_tiles.size());
+        // Open a slot at the end of the region's range.
+        memmove(tiles + end + 1, tiles + end, (valid_tile_count - end) * sizeof(int));
+        tiles[end] = index;
+        delta = 1;
+    } else {
+        for (int i = region->tile_start; i < end; i++) {
+            if (tiles[i] == index) {
+                memmove(tiles + i, tiles + i + 1, (valid_tile_count - i - 1) * sizeof(int));
+                delta = -1;
+                break;
+            }
+        }
+    }
+
+    region->tile_count += delta;
+    valid_tile_count += delta;
+    for (int i = region_index + 1; i < regions.size(); i++) {
+        regions[i]->tile_start += delta;
+    }
+}
+
+int DungeonMap::Level::find_tile(const Vector2& tile_id) const
+{
+    if (tile_size <= 0) {
+        return -1;
+    }
+    return get_tile_index(
+        (int)Math::floor(tile_id.x / tile_size),
+        (int)Math::floor(tile_id.y * -1.0f / tile_size)
+    );
+}
+
+AABB DungeonMap::Level::get_tile_aabb(int index) const
+{
+    Vector2 tile_id = get_tile_id(index);
+    return AABB(
+        Vector3(tile_id.x, 0.0f, tile_id.y),
+        Vector3(tile_size, MAX(get_tile_height(index), 0), tile_size)
+    );
+}
+
+void DungeonMap::Level::resize_tiles(int width, int height, int size)
+{
+    tile_width = width;
+    tile_height = height;
+    tile_size = size;
+
+    int count = width * height;
+    if (tile_types.size() != count) {
+        tile_types.resize(count);
+        tile_heights.resize(count);
+        tile_neighbors.resize(count);
+        valid_tiles.resize(count);
+    }
+    valid_tile_count = 0;
+    if (count == 0) {
+        return;
+    }
+
+    // Everything starts out empty until the tiles are built (-1 height).
+    memset(tile_types.ptrw(), EMPTY, count * sizeof(uint8_t));
+    memset(tile_heights.ptrw(), 0xff, count * sizeof(int16_t));
+    memset(tile_neighbors.ptrw(), 0, count * sizeof(uint8_t));
+}
+
+void DungeonMap::Level::clear_tiles()
+{
+    tile_width = 0;
+    tile_height = 0;
+    valid_tile_count = 0;
+}
+
+DungeonMap::Region* DungeonMap::find_region(const Vector2& region_id)
+{
+    return level->find_region(region_id);
+}
+
+int DungeonMap::find_tile(const Vector2& tile_id)
+{
+    return level->find_tile(tile_id);
 }
 
 Vector2 DungeonMap::get_random_map_location()
 {
-    if (valid_tiles.size() == 0) {
+    if (level->valid_tile_count == 0) {
         print_line("No valid tiles to spawn on!!!");
         return Vector2();
     }
 
-    Vector2 position = valid_tiles[Math::rand() % valid_tiles.size()];
-    Tile* tile = find_tile(position);
-    float floor_size_half = (float)(get_dungeon_params().floor_size) / 2.0f;
-    if (!tile) {
-        return Vector2();
-    }
+    int index = level->valid_tiles[level->rng.random(0, level->valid_tile_count - 1)];
+    Vector2 position = level->get_tile_id(index);
+    float floor_size_half = (float)(level->tile_size) / 2.0f;
 
     return Vector2(
         position.x + floor_size_half,
@@ -157,6 +604,30 @@ Vector2 DungeonMap::get_random_map_location()
     );
 }
 
+PoolVector2Array DungeonMap::sample_spawn_points(int count, float min_spacing, const Vector2& min_distance_from, float min_distance, int64_t rng_seed)
+{
+    PoolVector2Array points;
+    Vector<Vector2> samples;
+
+    // A stream of its own, so sampling doesn't depend on the map's generator.
+    DungeonMapRandom rng;
+    rng.seed((uint64_t)rng_seed, 2);
+
+    level_lock->read_lock();
+    DungeonMapSpawnSampler sampler(_get_path_grid(level), level->tile_size, min_spacing, min_distance_from, min_distance);
+    sampler.sample(level->valid_tiles.ptr(), level->valid_tile_count, count, rng, samples);
+    level_lock->read_unlock();
+
+    points.resize(samples.size());
+    {
+        PoolVector2Array::Write w = points.write();
+        for (int i = 0; i < samples.size(); i++) {
+            w[i] = samples[i];
+        }
+    }
+    return points;
+}
+
 Vector2 DungeonMap::get_tile_position(const Vector2& position)
 {
     return Vector2(
@@ -167,15 +638,361 @@ Vector2 DungeonMap::get_tile_position(const Vector2& position)
 
 bool DungeonMap::is_valid_position(const Vector2& position)
 {
-    Tile* tile = find_tile(get_tile_position(position));
-    if (!tile) return false;
+    int index = find_tile(get_tile_position(position));
+    if (index < 0) return false;
+
+    return level->get_tile_type(index) != EMPTY;
+}
+
+PoolVector3Array DungeonMap::find_path(const Vector3& from, const Vector3& to, bool allow_diagonal)
+{
+    PoolVector3Array points;
+    Vector<int> path;
+
+    level_lock->read_lock();
+    int from_index = level->find_tile(Vector2(from.x, from.z));
+    int to_index = level->find_tile(Vector2(to.x, to.z));
+
+    if (path_finder.find_path(_get_path_grid(level), from_index, to_index, allow_diagonal, path)) {
+        // The end tiles are replaced by the exact positions.
+        points.push_back(from);
+        for (int i = 1; i < path.size() - 1; i++) {
+            points.push_back(_get_tile_center(level, path[i]));
+        }
+        points.push_back(to);
+    }
+    level_lock->read_unlock();
+
+    return points;
+}
+
+PoolVector3Array DungeonMap::find_path_hierarchical(const Vector3& from, const Vector3& to)
+{
+    PoolVector3Array points;
+    Vector<int> path;
+
+    level_lock->read_lock();
+    DungeonMapPathFinder::Grid grid = _get_path_grid(level);
+    int from_index = level->find_tile(Vector2(from.x, from.z));
+    int to_index = level->find_tile(Vector2(to.x, to.z));
+
+    if (path_hierarchy.find_path(grid, from_index, to_index, path)) {
+        points.push_back(from);
+
+        // Only the way to the first portal (or to the goal inside a single
+        // cluster) is walked tile by tile, the segment's end is added below.
+        Vector<int> segment;
+        if (path.size() >= 2 && path_finder.find_path(grid, from_index, path[1], false, segment)) {
+            for (int i = 1; i < segment.size() - 1; i++) {
+                points.push_back(_get_tile_center(level, segment[i]));
+            }
+        }
+        for (int i = 1; i < path.size() - 1; i++) {
+            points.push_back(_get_tile_center(level, path[i]));
+        }
+        points.push_back(to);
+    }
+    level_lock->read_unlock();
+
+    return points;
+}
+
+Dictionary DungeonMap::raycast_grid(const Vector3& from, const Vector3& to)
+{
+    Dictionary result;
+    DungeonMapRaycast::Hit hit;
+
+    level_lock->read_lock();
+    if (DungeonMapRaycast::cast(_get_path_grid(level), _get_grid_position(level, from.x, from.z), _get_grid_position(level, to.x, to.z), &hit)) {
+        // Grid y grows north (towards -z).
+        result["position"] = from.linear_interpolate(to, hit.fraction);
+        result["normal"] = Vector3(hit.normal_x, 0.0f, -hit.normal_y);
+        result["tile"] = hit.tile >= 0 ? level->get_tile_id(hit.tile) : Vector2();
+        result["fraction"] = hit.fraction;
+    }
+    level_lock->read_unlock();
+
+    return result;
+}
+
+PoolByteArray DungeonMap::line_of_sight_batch(const PoolVector2Array& from, const PoolVector2Array& to)
+{
+    PoolByteArray visible;
+    ERR_FAIL_COND_V(from.size() != to.size(), visible);
+    visible.resize(from.size());
+
+    // A single read lock for the whole batch.
+    level_lock->read_lock();
+    {
+        PoolVector2Array::Read r_from = from.read();
+        PoolVector2Array::Read r_to = to.read();
+        PoolByteArray::Write w = visible.write();
+
+        DungeonMapPathFinder::Grid grid = _get_path_grid(level);
+        for (int i = 0; i < from.size(); i++) {
+            Vector2 start = _get_grid_position(level, r_from[i].x, r_from[i].y);
+            Vector2 end = _get_grid_position(level, r_to[i].x, r_to[i].y);
+            w[i] = DungeonMapRaycast::has_line_of_sight(grid, start, end) ? 1 : 0;
+        }
+    }
+    level_lock->read_unlock();
+
+    return visible;
+}
+
+float DungeonMap::get_wall_distance(const Vector3& position) const
+{
+    level_lock->read_lock();
+    int index = level->find_tile(Vector2(position.x, position.z));
+    float distance = (float)level->wall_distance.get_distance(index) / DungeonMapWallDistance::STRAIGHT_DISTANCE;
+    level_lock->read_unlock();
+
+    return distance;
+}
+
+PoolByteArray DungeonMap::get_wall_distance_field() const
+{
+    PoolByteArray distances;
+    level_lock->read_lock();
+    if (level->get_tile_count() > 0) {
+        distances = level->wall_distance.get_distances();
+    }
+    level_lock->read_unlock();
+
+    return distances;
+}
+
+Dictionary DungeonMap::get_connectivity_stats()
+{
+    // Tile edits only mark the components stale, they're labelled again
+    // here so the edits don't hold up the other queries.
+    level_lock->read_lock();
+    connectivity_mutex->lock();
+    if (level->connectivity_dirty) {
+        level->connectivity.analyze(level->tile_grid, level->tile_width, level->tile_height);
+        level->connectivity_dirty = false;
+    }
+    Dictionary stats = level->connectivity.to_dictionary();
+    stats["pruned_tile_count"] = level->pruned_tile_count;
+    connectivity_mutex->unlock();
+    level_lock->read_unlock();
+
+    return stats;
+}
+
+Array DungeonMap::get_entities_in_radius(const Vector3& position, float radius) const
+{
+    Vector<int64_t> ids;
+    entity_hash.query_radius(position, radius, ids);
+
+    Array result;
+    result.resize(ids.size());
+    for (int i = 0; i < ids.size(); i++) {
+        result[i] = ids[i];
+    }
+    return result;
+}
+
+Array DungeonMap::get_entities_in_region(const Vector2& position) const
+{
+    Vector<int64_t> ids;
+    entity_hash.query_region(position, ids);
+
+    Array result;
+    result.resize(ids.size());
+    for (int i = 0; i < ids.size(); i++) {
+        result[i] = ids[i];
+    }
+    return result;
+}
+
+int DungeonMap::request_path(const Vector3& from, const Vector3& to, bool allow_diagonal)
+{
+    int goal_tile = level->find_tile(Vector2(to.x, to.z));
+    int ticket = path_queue.push(goal_tile, from, to, allow_diagonal, OS::get_singleton()->get_ticks_usec());
+    set_physics_process_internal(true);
+    return ticket;
+}
+
+void DungeonMap::_service_path_requests(uint64_t budget_usec)
+{
+    uint64_t start = OS::get_singleton()->get_ticks_usec();
+    uint64_t now = start;
+    int served = 0;
+    Vector<DungeonMapPathQueue::Request> group;
+    Vector<int> path;
+
+    // At least one group is served every frame, so the queue always drains.
+    while (now - start < budget_usec && path_queue.pop_group(group) > 0) {
+        // The shared search is a 4-connected breadth first field. Walking it
+        // diagonally isn't the shortest 8-connected path, so diagonal
+        // requests always get a search of their own.
+        bool shared = group.size() > 1 && !group[0].allow_diagonal;
+        DungeonMapPathFinder::Grid grid = _get_path_grid(level);
+        if (shared) {
+            // One search from the goal serves every request of the group.
+            Vector<int> goals;
+            int goal = level->find_tile(Vector2(group[0].to.x, group[0].to.z));
+            if (goal >= 0) {
+                goals.push_back(goal);
+            }
+            path_queue_field.update(grid, goals, DungeonMapFlowField::UNREACHED - 1);
+        }
+
+        for (int i = 0; i < group.size(); i++) {
+            const DungeonMapPathQueue::Request& request = group[i];
+            PoolVector3Array points;
+            if (!shared) {
+                points = find_path(request.from, request.to, request.allow_diagonal);
+            } else if (path_queue_field.get_path(grid, level->find_tile(Vector2(request.from.x, request.from.z)), request.allow_diagonal, path)) {
+                points.push_back(request.from);
+                for (int j = 1; j < path.size() - 1; j++) {
+                    points.push_back(_get_tile_center(level, path[j]));
+                }
+                points.push_back(request.to);
+            }
+            now = OS::get_singleton()->get_ticks_usec();
+            path_queue.finish(request, points, shared, now);
+        }
+        served += group.size();
+
+        for (int i = 0; i < group.size(); i++) {
+            emit_signal("dungeon_map_path_ready", group[i].ticket);
+        }
+    }
+    path_queue.finish_frame(now - start, served);
+
+    if (path_queue.get_pending_count() == 0) {
+        set_physics_process_internal(false);
+    }
+}
 
-    return tile->type != EMPTY;
+Dictionary DungeonMap::get_path_queue_stats() const
+{
+    Dictionary result = path_queue.get_stats();
+    result["budget_usec"] = path_budget_usec;
+    return result;
+}
+
+void DungeonMap::set_tile_type(const Vector2& tile_id, TileType type)
+{
+    ERR_FAIL_COND(type != FLOOR && type != EMPTY);
+
+    int index = level->find_tile(tile_id);
+    if (index < 0 || level->get_tile_type(index) == type) {
+        return;
+    }
+    int x = index % level->tile_width;
+    int y = index / level->tile_width;
+
+    level_lock->write_lock();
+    _set_level_tile(level, index, type, true);
+
+    // Only the regions around the tile lose their cached portals.
+    path_hierarchy.invalidate_tile(x, y);
+    flow_field.clear();
+    path_queue_field.clear();
+    level_lock->write_unlock();
+
+    // The next apply rebuilds the level from the occupancy grid.
+    level->map_builder.set_floor_tile(x, y, type != EMPTY);
+    Region* region = level->find_region(level->get_tile_id(index));
+    if (region) {
+        region->dirty = true;
+    }
+    mark_dirty();
+
+    // An apply rebuilding this layout copied the grid before the edit, so
+    // the level being built takes it too.
+    if (!applying || !next_level_rebuilds_layout) {
+        return;
+    }
+    next_level->map_builder.set_floor_tile(x, y, type != EMPTY);
+    if (next_level->tile_width == level->tile_width && next_level->tile_height == level->tile_height) {
+        // Regions are built x-major, a region's tiles exist once its step ran.
+        int tiles_per_region = next_level->tiles_per_region;
+        int region_index = x / tiles_per_region * next_level->regions_per_side + y / tiles_per_region;
+        if (apply_phase > GENERATION_PHASE_TILES || region_index < apply_index) {
+            _set_level_tile(next_level, index, type, apply_phase > GENERATION_PHASE_WALL_DISTANCE);
+        } else {
+            next_level->tile_grid.set(x, y, type != EMPTY);
+        }
+        // Rows the wall distance build already passed miss the edit, start it over.
+        if (apply_phase == GENERATION_PHASE_WALL_DISTANCE) {
+            _set_apply_phase(GENERATION_PHASE_WALL_DISTANCE);
+        }
+    }
+    // Meshes built before the edit miss it, the map stays dirty after the swap.
+    edited_during_apply = true;
+}
+
+void DungeonMap::_set_level_tile(Level* p_level, int index, TileType type, bool update_distances)
+{
+    int x = index % p_level->tile_width;
+    int y = index / p_level->tile_width;
+
+    p_level->tile_types.ptrw()[index] = type;
+    p_level->tile_heights.ptrw()[index] = type == EMPTY ? -1 : 0;
+    p_level->set_tile_valid(index, type != EMPTY);
+    p_level->tile_grid.set(x, y, type != EMPTY);
+    // An edit can split a component or join two.
+    p_level->connectivity_dirty = true;
+
+    // The tile and its neighbors see the change in their masks.
+    for (int ny = y - 1; ny <= y + 1; ny++) {
+        for (int nx = x - 1; nx <= x + 1; nx++) {
+            int neighbor = p_level->get_tile_index(nx, ny);
+            if (neighbor >= 0) {
+                _update_tile_neighbors(p_level, neighbor);
+            }
+        }
+    }
+
+    // Only a window of wall distances around the tile changes.
+    if (update_distances) {
+        p_level->wall_distance.update_tile(_get_path_grid(p_level), x, y);
+    }
+}
+
+void DungeonMap::set_flow_target(const Vector3& target)
+{
+    PoolVector3Array targets;
+    targets.push_back(target);
+    set_flow_targets(targets);
+}
+
+void DungeonMap::set_flow_targets(const PoolVector3Array& targets)
+{
+    Vector<int> goals;
+    PoolVector3Array::Read r = targets.read();
+    for (int i = 0; i < targets.size(); i++) {
+        int index = level->find_tile(Vector2(r[i].x, r[i].z));
+        if (index >= 0) {
+            goals.push_back(index);
+        }
+    }
+    flow_field.update(_get_path_grid(level), goals, flow_radius);
+}
+
+Vector3 DungeonMap::get_flow_direction(const Vector3& position) const
+{
+    int index = level->find_tile(Vector2(position.x, position.z));
+    int dx, dy;
+    DungeonMapFlowField::get_direction_offset(flow_field.get_direction(index), dx, dy);
+
+    // Tile y grows north (towards -z).
+    return Vector3(dx, 0.0f, -dy).normalized();
+}
+
+int DungeonMap::get_flow_distance(const Vector3& position) const
+{
+    uint16_t distance = flow_field.get_distance(level->find_tile(Vector2(position.x, position.z)));
+    return distance == DungeonMapFlowField::UNREACHED ? -1 : distance;
 }
 
 void DungeonMap::set_map_tile_color(const Vector2& tile_id, Color color)
 {
-    map_builder.set_map_tile_color(tile_id, color);
+    level->map_builder.set_map_tile_color(tile_id, color);
 }
 
 void DungeonMap::add_navigation_meshes(Node* navigation)
@@ -188,9 +1005,9 @@ void DungeonMap::add_navigation_meshes(Node* navigation)
     }
 
     navigation_node = navigation;
-    for (auto e = regions.front(); e; e = e->next()) {
-        auto region = e->get();
-        if (region->nav_mesh.is_valid()) {
+    for (int i = 0; i < level->regions.size(); i++) {
+        Region* region = level->regions[i];
+        if (region->nav_mesh.is_valid() && region->nav_mesh_id == 0) {
             region->nav_mesh_id = ((Navigation*)(navigation))->navmesh_add(region->nav_mesh, region->transform, navigation);
             // print_line(String("Added navmesh id: ") + itos(region->nav_mesh_id) + String(" with polygon count: ") + itos(region->nav_mesh->get_polygon_count()));
         }
@@ -206,23 +1023,30 @@ void DungeonMap::remove_navigation_meshes(Node* navigation)
         return;
     }
 
-    for (auto e = regions.front(); e; e = e->next()) {
-        auto region = e->get();
-        if (region->nav_mesh.is_valid()) {
+    for (int i = 0; i < level->regions.size(); i++) {
+        Region* region = level->regions[i];
+        if (region->nav_mesh.is_valid() && region->nav_mesh_id != 0) {
             ((Navigation*)(navigation))->navmesh_remove(region->nav_mesh_id);
             region->nav_mesh_id = 0;
         }
     }
 }
 
+Dictionary DungeonMap::get_generation_stats() const
+{
+    Dictionary result = stats.to_dictionary();
+    result["enabled"] = stats_enabled;
+    return result;
+}
+
 Array DungeonMap::get_nav_meshes() const
 {
     Array nav_meshes;
     if (!is_inside_tree())
         return nav_meshes;
 
-    for (auto e = regions.front(); e; e = e->next()) {
-        auto region = e->get();
+    for (int i = 0; i < level->regions.size(); i++) {
+        Region* region = level->regions[i];
         if (region->nav_mesh.is_valid()) {
             nav_meshes.push_back(region->nav_mesh);
         }
@@ -230,95 +1054,90 @@ Array DungeonMap::get_nav_meshes() const
     return nav_meshes;
 }
 
-void DungeonMap::_build_regions()
+void DungeonMap::_analyze_connectivity()
 {
-    int tile_size = map_builder.params.floor_size;
-    int region_width = tiles_per_region * tile_size;
+    DungeonMapScopedTimer timer(_get_stat_counter(DungeonMapStats::STAGE_CONNECTIVITY));
+
+    // The walk only ever grows one component, islands come from cropping the
+    // walk to the map and from tiles changed with set_tile_type.
+    next_level->tile_grid = next_level->map_builder.get_grid();
+    next_level->connectivity.analyze(next_level->tile_grid, next_level->tile_width, next_level->tile_height);
+    next_level->connectivity_dirty = false;
+    next_level->pruned_tile_count = 0;
+    if (next_level->prune_islands && next_level->connectivity.get_component_count() > 1) {
+        next_level->pruned_tile_count = next_level->connectivity.prune(next_level->tile_grid);
+    }
+}
 
+void DungeonMap::_build_regions()
+{
     // Build out our region and the cells.
-    for (int x = 0; x < region_size; x++) {
-        for (int y = 0; y < region_size; y++) {
-            Vector2 id = Vector2(x, y);
-            if (regions.has(id))
-                continue;
-
-            Region* region = memnew(Region);
-            region->dirty = true;
-            region->aabb = AABB(
-                Vector3(
-                    x * region_width,
-                    0.0f,
-                    y * region_width * -1.0f
-                ),
-                Vector3(
-                    region_width,
-                    2,
-                    region_width
-                )
-            );
-            region->id = Vector2(region->aabb.position.x, region->aabb.position.z);
-
-            region->transform.translated(region->aabb.position);
-            regions[region->id] = region;
-            _build_tiles(region->id);
+    for (int x = 0; x < next_level->regions_per_side; x++) {
+        for (int y = 0; y < next_level->regions_per_side; y++) {
+            if (cancel_requested) return;
+            _build_region(x, y);
         }
     }
 }
 
-void DungeonMap::_build_tiles(const Vector2& region_id)
+void DungeonMap::_build_region(int x, int y)
 {
-    // Build out the tiles per region.
-    Ref<Image> map_image = get_map_image();
-    int tile_size = map_builder.params.floor_size;
-    int region_width = tile_size * tile_size;
+    DungeonMapScopedTimer timer(_get_stat_counter(DungeonMapStats::STAGE_TILES));
+    int tiles_per_region = next_level->tiles_per_region;
+    int region_width = tiles_per_region * next_level->tile_size;
+
+    Region* region = next_level->regions.alloc();
+    region->dirty = true;
+    region->aabb = AABB(
+        Vector3(
+            x * region_width,
+            0.0f,
+            y * region_width * -1.0f
+        ),
+        Vector3(
+            region_width,
+            2,
+            region_width
+        )
+    );
+    region->id = Vector2(region->aabb.position.x, region->aabb.position.z);
+    region->tile_x = x * tiles_per_region;
+    region->tile_y = y * tiles_per_region;
 
-    for (int x = 0; x < tiles_per_region; x++) {
-        for (int y = 0; y < tiles_per_region; y++) {
-            if (!regions.has(region_id)) {
+    region->transform.translated(region->aabb.position);
+    region->tile_start = next_level->valid_tile_count;
+    _build_tiles(region, x, y);
+}
+
+void DungeonMap::_build_tiles(Region* region, int x, int y)
+{
+    // Build out the tiles per region.
+    const DungeonMapGrid& grid = next_level->tile_grid;
+    int tiles_per_region = next_level->tiles_per_region;
+    int start_x = x * tiles_per_region;
+    int start_y = y * tiles_per_region;
+
+    uint8_t* types = next_level->tile_types.ptrw();
+    int16_t* heights = next_level->tile_heights.ptrw();
+    int* valid_tiles = next_level->valid_tiles.ptrw();
+
+    for (int tx = start_x; tx < start_x + tiles_per_region; tx++) {
+        for (int ty = start_y; ty < start_y + tiles_per_region; ty++) {
+            int index = next_level->get_tile_index(tx, ty);
+            if (index < 0) {
                 continue;
             }
 
-            // Create our tile.
-            Region* region = regions[region_id];
-            Tile* tile = memnew(Tile);
-            tile->local_position = Vector2(x, y);
-            tile->region_id = region_id;
-            tile->aabb = AABB(
-                Vector3(
-                    (x * tile_size) + region->aabb.position.x,
-                    0.0f,
-                    (y * tile_size * -1.0f) + region->aabb.position.z
-                ),
-                Vector3(
-                    tile_size,
-                    tile->height,
-                    tile_size
-                )
-            );
-            tile->id = Vector2(tile->aabb.position.x, tile->aabb.position.z);
-
-            int px = (int)Math::floor(tile->id.x);
-            int py = (int)Math::floor(tile->id.y * -1.0f);
-
-            map_image->lock();
-            Color pixel = map_image->get_pixel(px, py);
-            map_image->unlock();
-
-            if (pixel != Color(0, 0, 0)) {
-                tile->type = FLOOR;
-                valid_tiles.push_back(tile->id);
+            // Add floor tiles to the region. Empty tiles
+            // are skipped when building the mesh.
+            if (grid.get(tx, ty)) {
+                types[index] = FLOOR;
+                heights[index] = 0;
+                valid_tiles[next_level->valid_tile_count++] = index;
+                region->tile_count++;
             } else {
-                tile->height = -1;
-            }
-
-            // Save our tile.
-            tile->transform.translated(tile->aabb.position);
-            tiles[tile->id] = tile;
-
-            // Add tile to the region. Check for empty so
-            // we know how to build the mesh.
-            if (tile->type != EMPTY) {
-                region->tiles.push_back(tile->id);
+                types[index] = EMPTY;
+                heights[index] = -1;
             }
         }
     }
@@ -326,153 +1145,255 @@ void DungeonMap::_build_tiles(const Vector2& region_id)
 
 void DungeonMap::_update_tile_neighbors()
 {
-    // Update the neighbors.
-    for (Map<Vector2, Tile*>::Element* e = tiles.front(); e; e = e->next()) {
-        Tile* tile = e->get();
-        if (tile->neighbors.size() == 0) {
-            tile->neighbors.resize((uint8_t)MAX_TILE_NEIGHBORS);
-        }
-
-        int tile_size = map_builder.params.floor_size;
-        Vector2 tile_id = tile->id;
-        Vector2 north_pos = Vector2(tile_id.x, tile_id.y - tile_size);
-        Vector2 east_pos = Vector2(tile_id.x + tile_size, tile_id.y);
-        Vector2 south_pos = Vector2(tile_id.x, tile_id.y + tile_size);
-        Vector2 west_pos = Vector2(tile_id.x - tile_size, tile_id.y);
-
-        Vector2 north_east_pos = Vector2(tile_id.x + tile_size, tile_id.y - tile_size);
-        Vector2 north_west_pos = Vector2(tile_id.x - tile_size, tile_id.y - tile_size);
-        Vector2 south_east_pos = Vector2(tile_id.x + tile_size, tile_id.y + tile_size);
-        Vector2 south_west_pos = Vector2(tile_id.x - tile_size, tile_id.y + tile_size);
-
-        // Set the north tile.
-        Tile* nTile = find_tile(north_pos);
-        if (nTile) {
-            tile->neighbors[(uint8_t)Neighbor::NEIGHBOR_NORTH] = nTile;
-            tile->has_north_tile = true;
-        } else {
-            tile->neighbors[(uint8_t)Neighbor::NEIGHBOR_NORTH] = NULL;
-        }
+    DungeonMapScopedTimer timer(_get_stat_counter(DungeonMapStats::STAGE_NEIGHBORS));
 
-        // Set the east cell.
-        nTile = find_tile(east_pos);
-        if (nTile) {
-            tile->neighbors[(uint8_t)Neighbor::NEIGHBOR_EAST] = nTile;
-            tile->has_east_tile = true;
-        } else {
-            tile->neighbors[(uint8_t)Neighbor::NEIGHBOR_EAST] = NULL;
-        }
+    // Floor tiles match the tile grid, so all masks come from one pass over its rows.
+    const DungeonMapGrid& grid = next_level->tile_grid;
+    if (grid.get_width() == next_level->tile_width && grid.get_height() == next_level->tile_height) {
+        grid.compute_neighbor_masks(next_level->tile_neighbors.ptrw(), next_level->tile_width);
+        return;
+    }
 
-        // Set the south cell.
-        nTile = find_tile(south_pos);
-        if (nTile) {
-            tile->neighbors[(uint8_t)Neighbor::NEIGHBOR_SOUTH] = nTile;
-            tile->has_south_tile = true;
-        } else {
-            tile->neighbors[(uint8_t)Neighbor::NEIGHBOR_SOUTH] = NULL;
-        }
+    // Update the neighbors.
+    for (int i = 0; i < next_level->get_tile_count(); i++) {
+        if (cancel_requested) return;
+        _update_tile_neighbors(next_level, i);
+    }
+}
 
-        // Set the west cell.
-        nTile = find_tile(west_pos);
-        if (nTile) {
-            tile->neighbors[(uint8_t)Neighbor::NEIGHBOR_WEST] = nTile;
-            tile->has_west_tile = true;
-        } else {
-            tile->neighbors[(uint8_t)Neighbor::NEIGHBOR_WEST] = NULL;
+void DungeonMap::_update_tile_neighbors(Level* p_level, int index)
+{
+    // Tile offsets for each neighbor (north is +y).
+    static const int offsets[MAX_TILE_NEIGHBORS][2] = {
+        { 0, 1 }, { 1, 0 }, { 0, -1 }, { -1, 0 },
+        { 1, 1 }, { -1, 1 }, { 1, -1 }, { -1, -1 }
+    };
+
+    const uint8_t* types = p_level->tile_types.ptr();
+    int x = index % p_level->tile_width;
+    int y = index / p_level->tile_width;
+
+    uint8_t mask = 0;
+    for (int i = 0; i < MAX_TILE_NEIGHBORS; i++) {
+        int neighbor = p_level->get_tile_index(x + offsets[i][0], y + offsets[i][1]);
+        if (neighbor >= 0 && types[neighbor] != EMPTY) {
+            mask |= (1 << i);
         }
+    }
+    p_level->tile_neighbors.ptrw()[index] = mask;
+}
 
-        // Set the north-east cell.
-        nTile = find_tile(north_east_pos);
-        if (nTile) {
-            tile->neighbors[(uint8_t)Neighbor::NEIGHBOR_NORTH_EAST] = nTile;
-            tile->has_north_east_tile = true;
-        } else {
-            tile->neighbors[(uint8_t)Neighbor::NEIGHBOR_NORTH_EAST] = NULL;
-        }
+void DungeonMap::_update_wall_distances()
+{
+    DungeonMapScopedTimer timer(_get_stat_counter(DungeonMapStats::STAGE_WALL_DISTANCE));
+    next_level->wall_distance.build(_get_path_grid(next_level));
+}
 
-        // Set the north-west cell.
-        nTile = find_tile(north_west_pos);
-        if (nTile) {
-            tile->neighbors[(uint8_t)Neighbor::NEIGHBOR_NORTH_WEST] = nTile;
-            tile->has_north_west_tile = true;
-        } else {
-            tile->neighbors[(uint8_t)Neighbor::NEIGHBOR_NORTH_WEST] = NULL;
-        }
+void DungeonMap::_build_region_meshes()
+{
+    // Regions only read the tiles and write their own mesh data, so they
+    // can be built in any order on any thread.
+    DungeonMapScopedTimer timer(_get_stat_counter(DungeonMapStats::STAGE_FLOOR_MESH));
+    DungeonMapParallel::run(next_level->regions.size(), _build_region_mesh_job, this, mesh_thread_count);
+}
 
-        // Set the south-east cell.
-        nTile = find_tile(south_east_pos);
-        if (nTile) {
-            tile->neighbors[(uint8_t)Neighbor::NEIGHBOR_SOUTH_EAST] = nTile;
-            tile->has_south_east_tile = true;
-        } else {
-            tile->neighbors[(uint8_t)Neighbor::NEIGHBOR_SOUTH_EAST] = NULL;
-        }
+void DungeonMap::_build_region_mesh_job(void* p_userdata, int index)
+{
+    DungeonMap* dungeon_map = (DungeonMap*)p_userdata;
+    if (dungeon_map->cancel_requested) return;
+    dungeon_map->_build_region_mesh(dungeon_map->next_level->regions[index]);
+}
 
-        // Set the south-west cell.
-        nTile = find_tile(south_west_pos);
-        if (nTile) {
-            tile->neighbors[(uint8_t)Neighbor::NEIGHBOR_SOUTH_WEST] = nTile;
-            tile->has_south_west_tile = true;
-        } else {
-            tile->neighbors[(uint8_t)Neighbor::NEIGHBOR_SOUTH_WEST] = NULL;
+void DungeonMap::_build_region_mesh(Region* region)
+{
+    if (region->tile_count == 0) return;
+
+    if (next_level->merge_floor_tiles) {
+        // A floor and a ceiling quad per merged rectangle.
+        Vector<DungeonMapMeshBuilder::TileRect> rects;
+        DungeonMapMeshBuilder::merge_tiles(next_level, region->tile_x, region->tile_y, next_level->tiles_per_region, next_level->tiles_per_region, rects);
+
+        region->mesh_arrays.resize(rects.size() * 2);
+        DungeonMapMeshWriter writer(region->mesh_arrays);
+        for (int i = 0; i < rects.size(); i++) {
+            DungeonMapMeshBuilder::add_mesh_rect(next_level, &writer, rects[i], -99999, false);
+            DungeonMapMeshBuilder::add_mesh_rect(next_level, &writer, rects[i], next_level->ceiling_height, true);
         }
+        return;
+    }
+
+    // A floor and a ceiling quad per tile.
+    region->mesh_arrays.resize(region->tile_count * 2);
+    DungeonMapMeshWriter writer(region->mesh_arrays);
+    const int* tiles = next_level->get_region_tiles(region);
+    for (int i = 0; i < region->tile_count; i++) {
+        DungeonMapMeshBuilder::add_mesh_tile(next_level, &writer, tiles[i], false);
+        DungeonMapMeshBuilder::add_mesh_tile(next_level, &writer, tiles[i], next_level->ceiling_height, true);
     }
 }
 
-void DungeonMap::_build_region_meshes()
+void DungeonMap::_build_region_mesh_edges()
 {
-    for (Map<Vector2, Region*>::Element* e = regions.front(); e; e = e->next()) {
-        Region* region = e->get();
-        if (region->tiles.size() == 0) continue;
+    DungeonMapScopedTimer timer(_get_stat_counter(DungeonMapStats::STAGE_EDGE_MESH));
+    DungeonMapParallel::run(next_level->regions.size(), _build_region_mesh_edge_job, this, mesh_thread_count);
+}
 
-        SurfaceTool tool;
-        tool.begin(Mesh::PRIMITIVE_TRIANGLES);
-        for (int i = 0; i < region->tiles.size(); i++) {
-            DungeonMapMeshBuilder::add_mesh_tile(this, &tool, region->tiles[i], false);
-            DungeonMapMeshBuilder::add_mesh_tile(this, &tool, region->tiles[i], ceiling_height, true);
+void DungeonMap::_build_region_mesh_edge_job(void* p_userdata, int index)
+{
+    DungeonMap* dungeon_map = (DungeonMap*)p_userdata;
+    if (dungeon_map->cancel_requested) return;
+    dungeon_map->_build_region_mesh_edge(dungeon_map->next_level->regions[index]);
+}
+
+void DungeonMap::_build_region_mesh_edge(Region* region)
+{
+    if (region->tile_count == 0) return;
+
+    if (next_level->merge_wall_edges) {
+        // One quad per straight run of exposed sides (runs stop at the region bounds).
+        Vector<DungeonMapMeshBuilder::TileEdge> edges;
+        DungeonMapMeshBuilder::merge_tile_edges(next_level, region->tile_x, region->tile_y, next_level->tiles_per_region, next_level->tiles_per_region, edges);
+        if (edges.size() == 0) return;
+
+        region->edge_mesh_arrays.resize(edges.size());
+        DungeonMapMeshWriter writer(region->edge_mesh_arrays);
+        for (int i = 0; i < edges.size(); i++) {
+            DungeonMapMeshBuilder::add_mesh_edge(next_level, &writer, edges[i], next_level->ceiling_height, true, next_level->wall_slant);
         }
-        tool.generate_normals();
-        tool.index();
-        region->mesh = tool.commit();
+        return;
+    }
+
+    // Count the exposed sides first so the arrays are sized exactly.
+    const int* tiles = next_level->get_region_tiles(region);
+    int quad_count = 0;
+    for (int i = 0; i < region->tile_count; i++) {
+        quad_count += DungeonMapMeshBuilder::get_mesh_tile_edge_count(next_level, tiles[i]);
+    }
+    if (quad_count == 0) return;
+
+    region->edge_mesh_arrays.resize(quad_count);
+    DungeonMapMeshWriter writer(region->edge_mesh_arrays);
+    for (int i = 0; i < region->tile_count; i++) {
+        DungeonMapMeshBuilder::add_mesh_tile_edge(next_level, &writer, tiles[i], next_level->ceiling_height, true, next_level->wall_slant);
+    }
+}
 
-        // Create the mesh instance.
-        region->instance = VS::get_singleton()->instance_create2(region->mesh->get_rid(), get_world()->get_scenario());
-        VS::get_singleton()->instance_set_transform(region->instance, region->transform);
-        VS::get_singleton()->instance_set_visible(region->instance, true);
+void DungeonMap::_commit_region(Region* region)
+{
+    if (!region->mesh_arrays.is_empty()) {
+        {
+            DungeonMapScopedTimer timer(_get_stat_counter(DungeonMapStats::STAGE_MESH_COMMIT));
+            region->mesh = _commit_mesh_arrays(region->mesh_arrays);
+
+            // Create the mesh instance (hidden until the level is swapped in).
+            region->instance = VS::get_singleton()->instance_create2(region->mesh->get_rid(), get_world()->get_scenario());
+            VS::get_singleton()->instance_set_transform(region->instance, region->transform);
+            VS::get_singleton()->instance_set_visible(region->instance, false);
+        }
+        if (stats_enabled) {
+            stats.mesh_bytes += _get_mesh_array_bytes(region->mesh);
+        }
 
         // Create the collision shape.
-        _create_region_collision(region->id);
+        _create_region_collision(region);
 
         // Create the navigation mesh.
-        Ref<NavigationMesh> nav_mesh = memnew(NavigationMesh);
-        region->nav_mesh = nav_mesh;
-        region->nav_mesh->create_from_mesh(region->mesh);
+        _create_region_nav_mesh(region);
+    }
+
+    if (!region->edge_mesh_arrays.is_empty()) {
+        {
+            DungeonMapScopedTimer timer(_get_stat_counter(DungeonMapStats::STAGE_MESH_COMMIT));
+            region->edge_mesh = _commit_mesh_arrays(region->edge_mesh_arrays);
+
+            // Create the edge mesh instance (hidden until the level is swapped in).
+            region->edge_instance = VS::get_singleton()->instance_create2(region->edge_mesh->get_rid(), get_world()->get_scenario());
+            VS::get_singleton()->instance_set_transform(region->edge_instance, region->transform);
+            VS::get_singleton()->instance_set_visible(region->edge_instance, false);
+        }
+        if (stats_enabled) {
+            stats.mesh_bytes += _get_mesh_array_bytes(region->edge_mesh);
+        }
+
+        // Create the collision shape.
+        _create_region_edge_collision(region);
     }
 }
 
-void DungeonMap::_build_region_mesh_edges()
+void DungeonMap::_create_region_nav_mesh(Region* region)
 {
-    for (Map<Vector2, Region*>::Element* e = regions.front(); e; e = e->next()) {
-        Region* region = e->get();
-        if (region->tiles.size() == 0) continue;
+    DungeonMapScopedTimer timer(_get_stat_counter(DungeonMapStats::STAGE_NAVMESH));
+    Ref<NavigationMesh> nav_mesh = memnew(NavigationMesh);
+    region->nav_mesh = nav_mesh;
+
+    // One polygon per merged rectangle of floor, built from the tiles rather
+    // than the render mesh (which also holds the ceiling).
+    Vector<DungeonMapMeshBuilder::TileRect> rects;
+    DungeonMapMeshBuilder::merge_tiles(next_level, region->tile_x, region->tile_y, next_level->tiles_per_region, next_level->tiles_per_region, rects);
+
+    // Vertices are shared through the tile corners of the region. Every
+    // polygon has a vertex at each tile corner along its sides, so
+    // neighboring polygons (in this region or the next) share whole edges
+    // instead of meeting at T-junctions.
+    int corners = next_level->tiles_per_region + 1;
+    Vector<int> corner_vertices;
+    corner_vertices.resize(corners * corners);
+    for (int i = 0; i < corner_vertices.size(); i++) {
+        corner_vertices.ptrw()[i] = -1;
+    }
 
-        SurfaceTool tool;
-        tool.begin(Mesh::PRIMITIVE_TRIANGLES);
-        for (int i = 0; i < region->tiles.size(); i++) {
-            DungeonMapMeshBuilder::add_mesh_tile_edge(this, &tool, region->tiles[i], ceiling_height, true);
+    PoolVector<Vector3> vertices;
+    Vector<int> polygon;
+    for (int i = 0; i < rects.size(); i++) {
+        const DungeonMapMeshBuilder::TileRect& rect = rects[i];
+        int height = next_level->get_tile_height(next_level->get_tile_index(rect.x, rect.y));
+        int x0 = rect.x - region->tile_x;
+        int y0 = rect.y - region->tile_y;
+        int x1 = x0 + rect.width;
+        int y1 = y0 + rect.height;
+
+        // Walk the perimeter clockwise seen from above (north-west corner,
+        // east along the north side, then south, west and back north).
+        polygon.clear();
+        int x = x0;
+        int y = y1;
+        for (int side = 0; side < 4; side++) {
+            static const int steps[4][2] = { { 1, 0 }, { 0, -1 }, { -1, 0 }, { 0, 1 } };
+            int count = (side % 2 == 0) ? rect.width : rect.height;
+            for (int c = 0; c < count; c++) {
+                int& vertex = corner_vertices.ptrw()[y * corners + x];
+                if (vertex < 0) {
+                    vertex = vertices.size();
+                    vertices.push_back(Vector3((region->tile_x + x) * next_level->tile_size, height, (region->tile_y + y) * next_level->tile_size * -1.0f));
+                }
+                polygon.push_back(vertex);
+                x += steps[side][0];
+                y += steps[side][1];
+            }
         }
-        tool.generate_normals();
-        tool.index();
-        region->edge_mesh = tool.commit();
+        region->nav_mesh->add_polygon(polygon);
+    }
+    region->nav_mesh->set_vertices(vertices);
+}
 
-        // Create the edge mesh instance.
-        region->edge_instance = VS::get_singleton()->instance_create2(region->edge_mesh->get_rid(), get_world()->get_scenario());
-        VS::get_singleton()->instance_set_transform(region->edge_instance, region->transform);
-        VS::get_singleton()->instance_set_visible(region->edge_instance, true);
+Ref<ArrayMesh> DungeonMap::_commit_mesh_arrays(DungeonMapMeshArrays& arrays)
+{
+    Ref<ArrayMesh> mesh;
+    mesh.instance();
+    mesh->add_surface_from_arrays(Mesh::PRIMITIVE_TRIANGLES, arrays.get_arrays());
+    arrays.clear();
+    return mesh;
+}
 
-        // Create the collision shape.
-        _create_region_edge_collision(region->id);
+uint64_t DungeonMap::_get_mesh_array_bytes(const Ref<Mesh>& mesh)
+{
+    uint64_t bytes = 0;
+    for (int i = 0; i < mesh->get_surface_count(); i++) {
+        // Vertex, normal and uv per vertex, plus the indices.
+        bytes += mesh->surface_get_array_len(i) * (sizeof(Vector3) * 2 + sizeof(Vector2));
+        bytes += mesh->surface_get_array_index_len(i) * sizeof(int);
     }
+    return bytes;
 }
 
 void DungeonMap::_create_collision(StaticBody*& collision_body, CollisionShape*& collision_shape, Ref<Mesh> mesh, const Transform& transform)
@@ -484,6 +1405,13 @@ void DungeonMap::_create_collision(StaticBody*& collision_body, CollisionShape*&
     if (shape.is_null())
         return;
 
+    if (stats_enabled) {
+        Ref<ConcavePolygonShape> faces_shape = shape;
+        if (faces_shape.is_valid()) {
+            stats.shape_bytes += faces_shape->get_faces().size() * sizeof(Vector3);
+        }
+    }
+
     collision_body = memnew(StaticBody);
     collision_shape = memnew(CollisionShape);
     collision_shape->set_shape(shape);
@@ -495,14 +1423,13 @@ void DungeonMap::_create_collision(StaticBody*& collision_body, CollisionShape*&
     collision_body->set_name("collision_body");
     collision_body->set_transform(transform);
 
-    add_child(collision_body);
-    collision_body->set_owner(this);
+    // The body is added to the tree once the region is activated.
 }
 
-void DungeonMap::_create_region_collision(const Vector2& region_id)
+void DungeonMap::_create_region_collision(Region* region)
 {
-    Region* region = find_region(region_id);
     if (!region || !region->dirty) return;
+    DungeonMapScopedTimer timer(_get_stat_counter(DungeonMapStats::STAGE_COLLISION));
 
     if (region->mesh.is_null())
         return;
@@ -519,10 +1446,10 @@ void DungeonMap::_create_region_collision(const Vector2& region_id)
     _create_collision(region->collision_body, region->collision_shape, region->mesh, region->transform);
 }
 
-void DungeonMap::_create_region_edge_collision(const Vector2& region_id)
+void DungeonMap::_create_region_edge_collision(Region* region)
 {
-    Region* region = find_region(region_id);
     if (!region || !region->dirty) return;
+    DungeonMapScopedTimer timer(_get_stat_counter(DungeonMapStats::STAGE_COLLISION));
 
     if (region->edge_mesh.is_null())
         return;
@@ -544,8 +1471,8 @@ void DungeonMap::_update_visibility()
     if (!is_inside_tree())
         return;
 
-    for (auto e = regions.front(); e; e = e->next()) {
-        auto region = e->get();
+    for (int i = 0; i < level->regions.size(); i++) {
+        Region* region = level->regions[i];
 
         if (region->instance.is_valid()) {
             VS::get_singleton()->instance_set_visible(region->instance, is_visible());
@@ -576,7 +1503,19 @@ void DungeonMap::_notification(int p_what)
             apply();
         } break;
 
+        case NOTIFICATION_INTERNAL_PROCESS: {
+            if (applying) {
+                _apply_step(apply_budget_usec);
+            }
+        } break;
+
+        case NOTIFICATION_INTERNAL_PHYSICS_PROCESS: {
+            _service_path_requests(path_budget_usec);
+        } break;
+
         case NOTIFICATION_EXIT_WORLD: {
+            cancel_generation();
+            _wait_for_generation();
             clear();
         } break;
 
@@ -617,6 +1556,37 @@ void DungeonMap::_bind_methods()
 
     ClassDB::bind_method(D_METHOD("generate_map_image"), &DungeonMap::generate_map_image);
 
+    ClassDB::bind_method(D_METHOD("generate_async"), &DungeonMap::generate_async);
+    ClassDB::bind_method(D_METHOD("cancel_generation"), &DungeonMap::cancel_generation);
+    ClassDB::bind_method(D_METHOD("is_generating"), &DungeonMap::is_generating);
+    ClassDB::bind_method(D_METHOD("_finish_generation"), &DungeonMap::_finish_generation);
+    ClassDB::bind_method(D_METHOD("_emit_generation_progress", "phase", "fraction"), &DungeonMap::_emit_generation_progress);
+
+    ClassDB::bind_method(D_METHOD("set_incremental_apply", "enabled"), &DungeonMap::set_incremental_apply);
+    ClassDB::bind_method(D_METHOD("is_incremental_apply"), &DungeonMap::is_incremental_apply);
+    ClassDB::bind_method(D_METHOD("set_apply_budget_usec", "usec"), &DungeonMap::set_apply_budget_usec);
+    ClassDB::bind_method(D_METHOD("get_apply_budget_usec"), &DungeonMap::get_apply_budget_usec);
+    ClassDB::bind_method(D_METHOD("is_applying"), &DungeonMap::is_applying);
+
+    ClassDB::bind_method(D_METHOD("set_mesh_thread_count", "count"), &DungeonMap::set_mesh_thread_count);
+    ClassDB::bind_method(D_METHOD("get_mesh_thread_count"), &DungeonMap::get_mesh_thread_count);
+
+    ClassDB::bind_method(D_METHOD("set_merge_floor_tiles", "enabled"), &DungeonMap::set_merge_floor_tiles);
+    ClassDB::bind_method(D_METHOD("is_merge_floor_tiles"), &DungeonMap::is_merge_floor_tiles);
+
+    ClassDB::bind_method(D_METHOD("set_merge_wall_edges", "enabled"), &DungeonMap::set_merge_wall_edges);
+    ClassDB::bind_method(D_METHOD("is_merge_wall_edges"), &DungeonMap::is_merge_wall_edges);
+
+    ClassDB::bind_method(D_METHOD("set_prune_islands", "enabled"), &DungeonMap::set_prune_islands);
+    ClassDB::bind_method(D_METHOD("is_prune_islands"), &DungeonMap::is_prune_islands);
+
+    ClassDB::bind_method(D_METHOD("set_double_buffered", "enabled"), &DungeonMap::set_double_buffered);
+    ClassDB::bind_method(D_METHOD("is_double_buffered"), &DungeonMap::is_double_buffered);
+
+    ClassDB::bind_method(D_METHOD("set_generation_stats_enabled", "enabled"), &DungeonMap::set_generation_stats_enabled);
+    ClassDB::bind_method(D_METHOD("is_generation_stats_enabled"), &DungeonMap::is_generation_stats_enabled);
+    ClassDB::bind_method(D_METHOD("get_generation_stats"), &DungeonMap::get_generation_stats);
+
     ClassDB::bind_method(D_METHOD("get_nav_meshes"), &DungeonMap::get_nav_meshes);
     ClassDB::bind_method(D_METHOD("add_navigation_meshes", "navigation"), &DungeonMap::add_navigation_meshes);
     ClassDB::bind_method(D_METHOD("remove_navigation_meshes", "navigation"), &DungeonMap::remove_navigation_meshes);
@@ -630,26 +1600,86 @@ void DungeonMap::_bind_methods()
     ClassDB::bind_method(D_METHOD("get_tiles_per_region"), &DungeonMap::get_tiles_per_region);
     ClassDB::bind_method(D_METHOD("set_ceiling_height", "height"), &DungeonMap::set_ceiling_height);
     ClassDB::bind_method(D_METHOD("get_ceiling_height"), &DungeonMap::get_ceiling_height);
+    ClassDB::bind_method(D_METHOD("set_wall_slant", "slant"), &DungeonMap::set_wall_slant);
+    ClassDB::bind_method(D_METHOD("get_wall_slant"), &DungeonMap::get_wall_slant);
 
     ClassDB::bind_method(D_METHOD("set_dungeon_seed", "seed"), &DungeonMap::set_dungeon_seed);
     ClassDB::bind_method(D_METHOD("get_dungeon_seed"), &DungeonMap::get_dungeon_seed);
 
     ClassDB::bind_method(D_METHOD("get_random_map_location"), &DungeonMap::get_random_map_location);
+    ClassDB::bind_method(D_METHOD("sample_spawn_points", "count", "min_spacing", "min_distance_from", "min_distance", "rng_seed"), &DungeonMap::sample_spawn_points, DEFVAL(Vector2()), DEFVAL(0.0f), DEFVAL(0));
     ClassDB::bind_method(D_METHOD("get_tile_position", "position"), &DungeonMap::get_tile_position);
     ClassDB::bind_method(D_METHOD("is_valid_position", "position"), &DungeonMap::is_valid_position);
 
+    ClassDB::bind_method(D_METHOD("find_path", "from", "to", "allow_diagonal"), &DungeonMap::find_path, DEFVAL(false));
+    ClassDB::bind_method(D_METHOD("find_path_hierarchical", "from", "to"), &DungeonMap::find_path_hierarchical);
+    ClassDB::bind_method(D_METHOD("set_tile_type", "tile_id", "type"), &DungeonMap::set_tile_type);
+
+    ClassDB::bind_method(D_METHOD("raycast_grid", "from", "to"), &DungeonMap::raycast_grid);
+    ClassDB::bind_method(D_METHOD("line_of_sight_batch", "from", "to"), &DungeonMap::line_of_sight_batch);
+
+    ClassDB::bind_method(D_METHOD("get_wall_distance", "position"), &DungeonMap::get_wall_distance);
+    ClassDB::bind_method(D_METHOD("get_wall_distance_field"), &DungeonMap::get_wall_distance_field);
+    ClassDB::bind_method(D_METHOD("get_connectivity_stats"), &DungeonMap::get_connectivity_stats);
+
+    ClassDB::bind_method(D_METHOD("update_entity", "id", "position"), &DungeonMap::update_entity);
+    ClassDB::bind_method(D_METHOD("remove_entity", "id"), &DungeonMap::remove_entity);
+    ClassDB::bind_method(D_METHOD("get_entity_position", "id"), &DungeonMap::get_entity_position);
+    ClassDB::bind_method(D_METHOD("get_entity_count"), &DungeonMap::get_entity_count);
+    ClassDB::bind_method(D_METHOD("get_entities_in_radius", "position", "radius"), &DungeonMap::get_entities_in_radius);
+    ClassDB::bind_method(D_METHOD("get_entities_in_region", "position"), &DungeonMap::get_entities_in_region);
+
+    ClassDB::bind_method(D_METHOD("request_path", "from", "to", "allow_diagonal"), &DungeonMap::request_path, DEFVAL(false));
+    ClassDB::bind_method(D_METHOD("is_path_ready", "ticket"), &DungeonMap::is_path_ready);
+    ClassDB::bind_method(D_METHOD("take_path", "ticket"), &DungeonMap::take_path);
+    ClassDB::bind_method(D_METHOD("cancel_path_request", "ticket"), &DungeonMap::cancel_path_request);
+    ClassDB::bind_method(D_METHOD("get_path_queue_stats"), &DungeonMap::get_path_queue_stats);
+    ClassDB::bind_method(D_METHOD("reset_path_queue_stats"), &DungeonMap::reset_path_queue_stats);
+    ClassDB::bind_method(D_METHOD("set_path_budget_usec", "usec"), &DungeonMap::set_path_budget_usec);
+    ClassDB::bind_method(D_METHOD("get_path_budget_usec"), &DungeonMap::get_path_budget_usec);
+
+    ClassDB::bind_method(D_METHOD("set_flow_target", "target"), &DungeonMap::set_flow_target);
+    ClassDB::bind_method(D_METHOD("set_flow_targets", "targets"), &DungeonMap::set_flow_targets);
+    ClassDB::bind_method(D_METHOD("get_flow_direction", "position"), &DungeonMap::get_flow_direction);
+    ClassDB::bind_method(D_METHOD("get_flow_distance", "position"), &DungeonMap::get_flow_distance);
+    ClassDB::bind_method(D_METHOD("set_flow_radius", "radius"), &DungeonMap::set_flow_radius);
+    ClassDB::bind_method(D_METHOD("get_flow_radius"), &DungeonMap::get_flow_radius);
+
     ClassDB::bind_method(D_METHOD("set_map_tile_color", "tile_id", "color"), &DungeonMap::set_map_tile_color);
 
     ADD_SIGNAL(MethodInfo("dungeon_map_image_generated"));
     ADD_SIGNAL(MethodInfo("dungeon_map_apply_completed"));
+    ADD_SIGNAL(MethodInfo("dungeon_map_generation_progress", PropertyInfo(Variant::INT, "phase"), PropertyInfo(Variant::REAL, "fraction")));
+    ADD_SIGNAL(MethodInfo("dungeon_map_generation_canceled"));
+    ADD_SIGNAL(MethodInfo("dungeon_map_path_ready", PropertyInfo(Variant::INT, "ticket")));
+
+    BIND_ENUM_CONSTANT(EMPTY);
+    BIND_ENUM_CONSTANT(FLOOR);
+    BIND_ENUM_CONSTANT(WALL);
+    BIND_ENUM_CONSTANT(WATER);
+
+    BIND_ENUM_CONSTANT(GENERATION_PHASE_WALK);
+    BIND_ENUM_CONSTANT(GENERATION_PHASE_TILES);
+    BIND_ENUM_CONSTANT(GENERATION_PHASE_NEIGHBORS);
+    BIND_ENUM_CONSTANT(GENERATION_PHASE_WALL_DISTANCE);
+    BIND_ENUM_CONSTANT(GENERATION_PHASE_MESHES);
+    BIND_ENUM_CONSTANT(GENERATION_PHASE_EDGES);
+    BIND_ENUM_CONSTANT(GENERATION_PHASE_COMMIT);
 }
 
 DungeonMap::DungeonMap()
 {
     //set_notify_transform(true);
+    level_lock = RWLock::create();
+    connectivity_mutex = Mutex::create();
 }
 
 DungeonMap::~DungeonMap()
 {
+    cancel_generation();
+    _wait_for_generation();
     // clear();
+
+    memdelete(level_lock);
+    memdelete(connectivity_mutex);
 }
\ No newline at end of file
@@ -27,6 +27,9 @@
 #include <reference.h>
 #include <image.h>
 #include <math/aabb.h>
+#include <os/thread.h>
+#include <os/rw_lock.h>
+#include <os/mutex.h>
 #include <scene/3d/visual_instance.h>
 #include <scene/3d/spatial.h>
 #include <scene/3d/collision_object.h>
@@ -41,12 +44,27 @@
 #include <scene/resources/texture.h>
 
 #include "dungeon_map_builder.h"
+#include "dungeon_map_mesh_arrays.h"
+#include "dungeon_map_path_finder.h"
+#include "dungeon_map_path_hierarchy.h"
+#include "dungeon_map_path_queue.h"
+#include "dungeon_map_raycast.h"
+#include "dungeon_map_spatial_hash.h"
+#include "dungeon_map_spawn_sampler.h"
+#include "dungeon_map_wall_distance.h"
+#include "dungeon_map_connectivity.h"
+#include "dungeon_map_flow_field.h"
+#include "dungeon_map_pool.h"
+#include "dungeon_map_stats.h"
 
 class DungeonMap : public Spatial
 {
     GDCLASS(DungeonMap, Spatial);
     OBJ_CATEGORY("3D Visual Nodes");
 
+    // The benchmark runs the generation phases one at a time.
+    friend class DungeonMapBenchmark;
+
 public:
     // Types of tiles that can be generated.
     enum TileType
@@ -74,13 +92,32 @@ public:
         MAX_TILE_NEIGHBORS
     };
 
+    // Phases reported while generating the dungeon.
+    enum GenerationPhase
+    {
+        GENERATION_PHASE_WALK = 0,
+        GENERATION_PHASE_TILES,
+        GENERATION_PHASE_NEIGHBORS,
+        GENERATION_PHASE_WALL_DISTANCE,
+        GENERATION_PHASE_MESHES,
+        GENERATION_PHASE_EDGES,
+        GENERATION_PHASE_COMMIT,
+
+        MAX_GENERATION_PHASES
+    };
+
     // Regions are groups of tiles.
     struct Region
     {
         // Position of the region.
         Vector2 id;
-        // Tiles in the region.
-        Vector<Vector2> tiles;
+        // Tile coordinates of the region's first tile.
+        int tile_x = 0;
+        int tile_y = 0;
+        // First of the region's non-empty tiles in the level's valid tiles.
+        int tile_start = 0;
+        // Number of non-empty tiles in the region.
+        int tile_count = 0;
         // AABB for the region.
         AABB aabb;
 
@@ -93,6 +130,11 @@ public:
         Ref<Mesh> mesh;
         // Reference to the edge mesh.
         Ref<Mesh> edge_mesh;
+        // Land mesh arrays waiting to be committed on the main thread.
+        DungeonMapMeshArrays mesh_arrays;
+        // Edge mesh arrays waiting to be committed on the main thread.
+        DungeonMapMeshArrays edge_mesh_arrays;
+
         // Reference to the navigation mesh.
         Ref<NavigationMesh> nav_mesh;
         // NavigationMesh id when added to the Navigation node.
@@ -115,57 +157,130 @@ public:
         bool dirty = true;
     };
 
-    // Tile that makes up a level.
-    struct Tile
+    // Everything generated for a single dungeon. The map keeps two levels so
+    // the next dungeon can be built while the current one stays live.
+    struct Level
     {
-        // Position of the tile.
-        Vector2 id;
-        // Region id for the tile.
-        Vector2 region_id;
-        // Local position relative to the region.
-        Vector2 local_position;
-        // Type of tile when generating the mesh.
-        TileType type = TileType::EMPTY;
-        // Tile Neighbors
-        Vector<Tile*> neighbors;
-
-        // AABB for the tile.
-        AABB aabb;
-
-        // Height of the cell.
-        int height = 0;
-
-        // Transform for the tile.
-        Transform transform;
-
-        // Has a north tile neighbor.
-        bool has_north_tile = false;
-        // Has a east tile neighbor.
-        bool has_east_tile = false;
-        // Has a south tile neighbor.
-        bool has_south_tile = false;
-        // Has a west tile neighbor.
-        bool has_west_tile = false;
-        // Has a north-east tile neighbor.
-        bool has_north_east_tile = false;
-        // Has a north-west tile neighbor.
-        bool has_north_west_tile = false;
-        // Has a south-east tile neighbor.
-        bool has_south_east_tile = false;
-        // Has a south-west tile neighbor.
-        bool has_south_west_tile = false;
+        // Map builder holding the occupancy grid.
+        DungeonMapBuilder map_builder;
+        // Random generator for map queries (seeded from the dungeon seed).
+        DungeonMapRandom rng;
+
+        // Regions of the map, in build order (x-major by region coordinates).
+        DungeonMapPool<Region> regions;
+        // Regions along each axis.
+        int regions_per_side = 0;
+        // Tiles per region along each axis.
+        int tiles_per_region = 0;
+
+        // Settings the level is built with. They're copied from the map when
+        // the build starts, so setters called while it runs don't reach it.
+        // Seed of the layout.
+        int64_t seed = 0;
+        // Flag for whether or not floor and ceiling tiles are merged into larger quads.
+        bool merge_floor_tiles = false;
+        // Flag for whether or not straight runs of wall edges are merged into single quads.
+        bool merge_wall_edges = false;
+        // Flag for whether or not islands are pruned from the tile grid.
+        bool prune_islands = false;
+        // Height of the ceiling.
+        int ceiling_height = 0;
+        // Slant of the walls.
+        float wall_slant = 0.0f;
+
+        // Tiles are stored row-major by tile coordinates, one entry per
+        // tile in each array (tile x grows east, tile y grows north).
+        // Width of the map in tiles.
+        int tile_width = 0;
+        // Height of the map in tiles.
+        int tile_height = 0;
+        // Size of a single tile.
+        int tile_size = 0;
+        // Type of each tile.
+        Vector<uint8_t> tile_types;
+        // Height of each tile.
+        Vector<int16_t> tile_heights;
+        // Non-empty neighbors of each tile (one bit per Neighbor).
+        Vector<uint8_t> tile_neighbors;
+        // Indices of the non-empty tiles, grouped by region.
+        Vector<int> valid_tiles;
+        // Number of entries used in valid_tiles.
+        int valid_tile_count = 0;
+        // Distance from each tile to the nearest wall.
+        DungeonMapWallDistance wall_distance;
+        // Floor tiles the level is built from: the builder's grid, without
+        // the pruned islands (shares the builder's storage until pruned).
+        DungeonMapGrid tile_grid;
+        // Connected components of the floor tiles.
+        DungeonMapConnectivity connectivity;
+        // Flag for whether or not tiles changed since the components were labelled.
+        bool connectivity_dirty = false;
+        // Number of floor tiles pruned from the smaller components.
+        int pruned_tile_count = 0;
+
+        // Resizes the tile arrays and resets every tile to empty. The arrays
+        // are only reallocated when the number of tiles changes.
+        void resize_tiles(int width, int height, int size);
+        // Empties the tile arrays (keeps their memory for the next build).
+        void clear_tiles();
+
+        // Attempts to return a region based on the given coordinates/id.
+        Region* find_region(const Vector2& region_id) const;
+        // Returns the index of the tile with the given id/position, or -1 if it's outside of the map.
+        int find_tile(const Vector2& tile_id) const;
+
+        // Returns the index of a tile from its tile coordinates, or -1 if it's outside of the map.
+        _FORCE_INLINE_ int get_tile_index(int x, int y) const
+        {
+            if (x < 0 || y < 0 || x >= tile_width || y >= tile_height) {
+                return -1;
+            }
+            return y * tile_width + x;
+        }
+        // Returns the number of tiles.
+        _FORCE_INLINE_ int get_tile_count() const { return tile_width * tile_height; }
+        // Adds a tile to (or removes it from) the valid tiles of its region,
+        // the ranges of the regions after it are shifted to match.
+        void set_tile_valid(int index, bool valid);
+        // Returns the indices of a region's non-empty tiles.
+        _FORCE_INLINE_ const int* get_region_tiles(const Region* region) const { return valid_tiles.ptr() + region->tile_start; }
+
+        // Returns the id (top-left position) of a tile.
+        _FORCE_INLINE_ Vector2 get_tile_id(int index) const
+        {
+            return Vector2((index % tile_width) * tile_size, (index / tile_width) * tile_size * -1.0f);
+        }
+        // Returns the AABB of a tile.
+        AABB get_tile_aabb(int index) const;
+
+        // Returns the type of a tile.
+        _FORCE_INLINE_ TileType get_tile_type(int index) const { return (TileType)tile_types[index]; }
+        // Returns the height of a tile.
+        _FORCE_INLINE_ int get_tile_height(int index) const { return tile_heights[index]; }
+        // Returns the neighbor mask of a tile.
+        _FORCE_INLINE_ uint8_t get_tile_neighbors(int index) const { return tile_neighbors[index]; }
+        // Checks if a tile has a non-empty neighbor.
+        _FORCE_INLINE_ bool has_tile_neighbor(int index, Neighbor neighbor) const { return (tile_neighbors[index] >> neighbor) & 1; }
     };
 
 private:
-    // Reference to the map builder.
-    DungeonMapBuilder map_builder;
-
-    // Regions of the map.
-    Map<Vector2, Region*> regions;
-    // Tiles of the map.
-    Map<Vector2, Tile*> tiles;
-    // List of valid tiles for the current map.
-    Vector<Vector2> valid_tiles;
+    // Parameters used when generating the dungeon.
+    DungeonMapBuilder::DungeonParams params;
+
+    // Storage for the live and the next level.
+    Level levels[2];
+    // Level that is currently displayed and queried.
+    Level* level = &levels[0];
+    // Level that is being generated/built.
+    Level* next_level = &levels[1];
+    // Flag for whether or not the next level has a freshly generated grid.
+    bool next_level_generated = false;
+    // Flag for whether or not the level being built is a rebuild of the live layout.
+    bool next_level_rebuilds_layout = false;
+    // Flag for whether or not a tile was changed after the next level's meshes started building.
+    bool edited_during_apply = false;
+    // Flag for whether or not the current level stays live while the next one builds.
+    bool double_buffered = false;
 
     // Reference to the navigation node.
     Node* navigation_node = NULL;
@@ -176,30 +291,178 @@ private:
     int tiles_per_region = 4;
     // Celling height.
     int ceiling_height = 8;
+    // Distance the bottom of the walls is pushed out (0 for straight walls).
+    float wall_slant = 0.0f;
 
     // Flag for whether or not the dungeon is dirty.
     bool dirty = true;
 
+    // Number of threads used to build the region meshes (0 = one per processor).
+    int mesh_thread_count = 0;
+    // Flag for whether or not floor and ceiling tiles are merged into larger quads.
+    bool merge_floor_tiles = false;
+    // Flag for whether or not straight runs of wall edges are merged into single quads.
+    bool merge_wall_edges = false;
+    // Flag for whether or not floor tiles outside of the largest connected component are removed.
+    bool prune_islands = false;
+
+    // Flag for whether or not the generation stages are timed.
+    bool stats_enabled = false;
+    // Timings and memory counters for the last generation.
+    DungeonMapStats stats;
+
+    // Returns the counter for a stage, or NULL when stats are disabled.
+    _FORCE_INLINE_ uint64_t* _get_stat_counter(DungeonMapStats::Stage stage) { return stats_enabled ? &stats.stage_usec[stage] : NULL; }
+    // Returns the number of bytes used by the arrays of a mesh.
+    static uint64_t _get_mesh_array_bytes(const Ref<Mesh>& mesh);
+
+    // Guards the live level pointer for queries made from other threads
+    // (held for writing while the levels are swapped or cleared).
+    RWLock* level_lock = NULL;
+    // Serializes labelling the live level's components again (under the read lock).
+    Mutex* connectivity_mutex = NULL;
+    // Path queries over the tiles of the live level.
+    DungeonMapPathFinder path_finder;
+    // Portal graph over the regions of the live level for long path queries.
+    DungeonMapPathHierarchy path_hierarchy;
+    // Flow field towards the flow targets on the live level.
+    DungeonMapFlowField flow_field;
+    // Number of steps the flow field spreads out from its targets.
+    int flow_radius = 64;
+    // Path requests waiting to be served during the physics frames.
+    DungeonMapPathQueue path_queue;
+    // Search shared by the 4-connected path requests with the same goal tile.
+    DungeonMapFlowField path_queue_field;
+    // Time the path requests may take per physics frame (microseconds).
+    int path_budget_usec = 1000;
+    // Registered entities bucketed by the tiles and regions of the live level.
+    DungeonMapSpatialHash entity_hash;
+
+    // Returns the tile grid of a level for path and flow queries.
+    _FORCE_INLINE_ DungeonMapPathFinder::Grid _get_path_grid(const Level* p_level) const
+    {
+        DungeonMapPathFinder::Grid grid;
+        grid.types = p_level->tile_types.ptr();
+        grid.width = p_level->tile_width;
+        grid.height = p_level->tile_height;
+        return grid;
+    }
+
+    // Returns the grid space position (one unit per tile) of a floor position.
+    _FORCE_INLINE_ Vector2 _get_grid_position(const Level* p_level, float x, float z) const
+    {
+        if (p_level->tile_size <= 0) {
+            return Vector2(-1.0f, -1.0f);
+        }
+        return Vector2(x / p_level->tile_size, z * -1.0f / p_level->tile_size);
+    }
+
+    // Returns the position at the center of a tile (on the floor).
+    _FORCE_INLINE_ Vector3 _get_tile_center(const Level* p_level, int index) const
+    {
+        Vector2 id = p_level->get_tile_id(index);
+        float half = p_level->tile_size * 0.5f;
+        return Vector3(id.x + half, p_level->get_tile_height(index), id.y - half);
+    }
+
+    // Worker thread for asynchronous generation.
+    Thread* generation_thread = NULL;
+    // Flag for whether or not the dungeon is being generated on the worker thread.
+    bool generating = false;
+    // Flag for whether or not the current generation should stop.
+    volatile bool cancel_requested = false;
+
+    // Flag for whether or not apply() is spread over multiple idle frames.
+    bool incremental_apply = false;
+    // Time budget (in microseconds) per frame for the incremental apply.
+    int apply_budget_usec = 2000;
+    // Flag for whether or not an apply is in progress.
+    bool applying = false;
+    // Current phase of the apply.
+    GenerationPhase apply_phase = GENERATION_PHASE_TILES;
+    // Number of items processed in the current phase.
+    int apply_index = 0;
+
+    // Starts applying the dungeon from the given phase.
+    void _begin_apply(GenerationPhase phase);
+    // Moves the apply to the given phase.
+    void _set_apply_phase(GenerationPhase phase);
+    // Processes the apply until it finishes or runs out of time (0 = no limit). Returns true once finished.
+    bool _apply_step(uint64_t budget_usec);
+    // Finishes the apply, swaps in the new level and emits the completed signal.
+    void _finish_apply();
+
+    // Frees all tiles/regions and their resources for a level.
+    void _clear_level(Level* p_level);
+    // Ensures the next level has a grid to build from.
+    void _prepare_next_level();
+    // Swaps the next level in and retires the current one.
+    void _swap_levels();
+    // Makes a committed region live (visibility, collision and navigation).
+    void _activate_region(Region* region);
+
+    // Entry point for the generation thread.
+    static void _generation_thread_func(void* p_userdata);
+    // Runs the CPU-only generation phases.
+    void _generate();
+    // Finishes the asynchronous generation on the main thread.
+    void _finish_generation();
+    // Waits for the generation thread to exit.
+    void _wait_for_generation();
+    // Serves the queued path requests until the budget runs out.
+    void _service_path_requests(uint64_t budget_usec);
+    // Reports the generation progress.
+    void _report_progress(GenerationPhase phase, float fraction);
+    // Emits the generation progress signal (main thread).
+    void _emit_generation_progress(int phase, float fraction);
+
+    // Labels the connected components of the next level's floor grid and
+    // prunes the unreachable islands from its tile grid when enabled (the
+    // builder keeps them, so they come back once pruning is turned off).
+    void _analyze_connectivity();
     // Build the regions/tiles.
     void _build_regions();
+    // Build a single region and its tiles.
+    void _build_region(int x, int y);
     // Build the tiles.
-    void _build_tiles(const Vector2& region_id);
+    void _build_tiles(Region* region, int x, int y);
     // Update the tile neighbors.
     void _update_tile_neighbors();
-
-    // Builds the region meshes.
+    // Update the neighbors of a single tile.
+    void _update_tile_neighbors(Level* p_level, int index);
+    // Changes the type of a built tile of a level: its arrays, valid tiles,
+    // neighbor masks and tile grid (and wall distances when they're built).
+    void _set_level_tile(Level* p_level, int index, TileType type, bool update_distances);
+    // Builds the distance to the nearest wall for every tile.
+    void _update_wall_distances();
+
+    // Builds the region meshes (in parallel).
     void _build_region_meshes();
-    // Builds the region mesh edges.
+    // Builds the mesh for a single region (parallel job).
+    static void _build_region_mesh_job(void* p_userdata, int index);
+    // Builds the mesh for a single region.
+    void _build_region_mesh(Region* region);
+    // Builds the region mesh edges (in parallel).
     void _build_region_mesh_edges();
+    // Builds the mesh edges for a single region (parallel job).
+    static void _build_region_mesh_edge_job(void* p_userdata, int index);
+    // Builds the mesh edges for a single region.
+    void _build_region_mesh_edge(Region* region);
+    // Commits the built meshes for a single region to the visual server, collision and navigation.
+    void _commit_region(Region* region);
+    // Creates the navigation mesh for a region.
+    void _create_region_nav_mesh(Region* region);
+    // Creates a mesh from the arrays and releases them.
+    static Ref<ArrayMesh> _commit_mesh_arrays(DungeonMapMeshArrays& arrays);
 
     // Create a collision mesh from a given mesh.
     void _create_collision(StaticBody*& collision_body, CollisionShape*& collision_shape, Ref<Mesh> mesh, const Transform& transform);
 
     // Create the collisions for a region.
-    void _create_region_collision(const Vector2& region_id);
+    void _create_region_collision(Region* region);
 
     // Create the edge collisions for a region.
-    void _create_region_edge_collision(const Vector2& region_id);
+    void _create_region_edge_collision(Region* region);
 
     // Updates the visibility of the node.
 	void _update_visibility();
@@ -234,20 +497,126 @@ public:
     // Generates the map image.
     void generate_map_image();
 
+    // Generates and applies the dungeon on a worker thread.
+    void generate_async();
+    // Cancels the asynchronous generation.
+    void cancel_generation();
+    // Checks if the dungeon is being generated asynchronously.
+    _FORCE_INLINE_ bool is_generating() const { return generating; }
+
     // Attempts to return a region based on the given coordinates/id.
     Region* find_region(const Vector2& region_id);
-    // Attempts to return a tile based on the given coordinates/id.
-    Tile* find_tile(const Vector2& tile_id);
+    // Returns the index of the tile with the given id/position, or -1 if it's outside of the map.
+    int find_tile(const Vector2& tile_id);
 
     // Returns a random map location (based on the initial seed).
     Vector2 get_random_map_location();
 
+    // Returns up to count spawn positions (x, z) on the floor tiles, at least
+    // min_spacing apart and min_distance away from min_distance_from. The
+    // same seed gives the same positions on the same level.
+    PoolVector2Array sample_spawn_points(int count, float min_spacing, const Vector2& min_distance_from = Vector2(), float min_distance = 0.0f, int64_t rng_seed = 0);
+
     // Returns the "snapped" tile position given a position.
     Vector2 get_tile_position(const Vector2& position);
 
     // Checks if a position is valid.
     bool is_valid_position(const Vector2& position);
 
+    // Finds the shortest path between two positions over the floor tiles.
+    // Returns the start, the tile centers where the path turns and the end,
+    // or an empty array when there's no path. Safe to call from any thread.
+    PoolVector3Array find_path(const Vector3& from, const Vector3& to, bool allow_diagonal = false);
+    // Finds a path between two positions over the region portals. Only the
+    // way to the first portal is refined into tiles, the rest of the path is
+    // the portal tile centers. Cheaper than find_path across large maps, but
+    // the path may be slightly longer. Safe to call from any thread.
+    PoolVector3Array find_path_hierarchical(const Vector3& from, const Vector3& to);
+
+    // Changes a tile of the live level to FLOOR or EMPTY (main thread only),
+    // the occupancy grid doesn't keep other types. Path queries and spawn
+    // locations see the change right away. The tile's region is marked dirty,
+    // its mesh and collision are rebuilt on the next apply. An apply that
+    // rebuilds the live layout takes the change along and leaves the map
+    // dirty, a generation in progress replaces the layout.
+    void set_tile_type(const Vector2& tile_id, TileType type);
+
+    // Casts a ray over the tiles between two positions (empty tiles block
+    // it). Returns an empty Dictionary if nothing blocks the ray, otherwise
+    // the hit "position", "normal", "tile" (tile id) and "fraction" along
+    // the ray. Safe to call from any thread.
+    Dictionary raycast_grid(const Vector3& from, const Vector3& to);
+    // Checks the lines of sight between pairs of floor positions (x, z).
+    // Returns a byte per pair, 1 if nothing blocks the line. Safe to call
+    // from any thread.
+    PoolByteArray line_of_sight_batch(const PoolVector2Array& from, const PoolVector2Array& to);
+
+    // Returns the distance (in tiles) from a position to the nearest wall,
+    // 0 on walls and outside of the map. Safe to call from any thread.
+    float get_wall_distance(const Vector3& position) const;
+    // Returns the distance to the nearest wall of every tile (row-major, tile
+    // y grows north), in units of a third of a tile (3 per straight step, 4
+    // per diagonal step, saturating at 255). Shares the map's storage.
+    // Safe to call from any thread.
+    PoolByteArray get_wall_distance_field() const;
+
+    // Returns the connected components of the live level's floor tiles (the
+    // tiles are labelled again after set_tile_type changed them): their count,
+    // sizes and bounding boxes (Rect2 in tile coordinates), the largest
+    // component and the number of tiles pruned when the level was built.
+    // Safe to call from any thread.
+    Dictionary get_connectivity_stats();
+
+    // Registers an entity or moves it to a new position (main thread only).
+    _FORCE_INLINE_ void update_entity(int64_t id, const Vector3& position) { entity_hash.update(id, position); }
+    // Unregisters an entity.
+    _FORCE_INLINE_ void remove_entity(int64_t id) { entity_hash.remove(id); }
+    // Returns the last position of an entity.
+    _FORCE_INLINE_ Vector3 get_entity_position(int64_t id) const { return entity_hash.get_position(id); }
+    // Returns the number of registered entities.
+    _FORCE_INLINE_ int get_entity_count() const { return entity_hash.get_entity_count(); }
+    // Returns the ids of the entities within a radius of a position (on the floor plane).
+    Array get_entities_in_radius(const Vector3& position, float radius) const;
+    // Returns the ids of the entities in the region containing a floor position (x, z).
+    Array get_entities_in_region(const Vector2& position) const;
+
+    // Queues a path request (main thread only), the path is searched during
+    // one of the next physics frames. Returns a ticket to poll for the path,
+    // dungeon_map_path_ready is emitted with the ticket once it's found.
+    int request_path(const Vector3& from, const Vector3& to, bool allow_diagonal = false);
+    // Checks if the path for a ticket can be taken.
+    _FORCE_INLINE_ bool is_path_ready(int ticket) const { return path_queue.is_ready(ticket); }
+    // Returns the path for a ticket and forgets it (empty if there's no path).
+    _FORCE_INLINE_ PoolVector3Array take_path(int ticket) { return path_queue.take(ticket); }
+    // Cancels a path request or drops its untaken path.
+    _FORCE_INLINE_ void cancel_path_request(int ticket) { path_queue.cancel(ticket); }
+    // Returns the queue depth and latency statistics of the path requests.
+    Dictionary get_path_queue_stats() const;
+    // Resets the path request statistics.
+    _FORCE_INLINE_ void reset_path_queue_stats() { path_queue.reset_stats(); }
+
+    // Sets the time the path requests may take per physics frame.
+    _FORCE_INLINE_ void set_path_budget_usec(int usec) { path_budget_usec = MAX(usec, 1); }
+    // Returns the time the path requests may take per physics frame.
+    _FORCE_INLINE_ int get_path_budget_usec() const { return path_budget_usec; }
+
+    // Sets the position the flow field leads to (main thread only). The
+    // field is only rebuilt when the target moves to another tile.
+    void set_flow_target(const Vector3& target);
+    // Sets the positions the flow field leads to, agents follow the nearest one.
+    void set_flow_targets(const PoolVector3Array& targets);
+    // Returns the direction (on the floor plane) an agent at the position
+    // should move in to reach the nearest flow target. Returns a zero vector
+    // on a target's tile or out of the field's reach.
+    Vector3 get_flow_direction(const Vector3& position) const;
+    // Returns the number of tiles between a position and the nearest flow target, or -1 if it's out of reach.
+    int get_flow_distance(const Vector3& position) const;
+
+    // Sets the number of steps the flow field spreads out from its targets.
+    _FORCE_INLINE_ void set_flow_radius(int radius) { flow_radius = MAX(radius, 0); }
+    // Returns the number of steps the flow field spreads out from its targets.
+    _FORCE_INLINE_ int get_flow_radius() const { return flow_radius; }
+
     // Set the map image color for a specific tile.
     void set_map_tile_color(const Vector2& tile_id, Color color);
 
@@ -265,9 +634,9 @@ public:
     _FORCE_INLINE_ bool is_dirty() { return dirty; }
 
     // Returns the map image.
-    _FORCE_INLINE_ Ref<Image> get_map_image() const { return map_builder.get_map_image(); }
+    _FORCE_INLINE_ Ref<Image> get_map_image() { return level->map_builder.get_map_image(); }
     // Returns the map texture.
-    _FORCE_INLINE_ Ref<ImageTexture> get_map_texture() const { return map_builder.get_map_texture(); }
+    _FORCE_INLINE_ Ref<ImageTexture> get_map_texture() { return level->map_builder.get_map_texture(); }
 
     // Sets the size of the region.
     _FORCE_INLINE_ void set_region_size(int size) { mark_dirty(); region_size = size; }
@@ -278,23 +647,74 @@ public:
     // Returns the tile per region.
     _FORCE_INLINE_ int get_tiles_per_region() const { return tiles_per_region; }
 
+    // Sets whether or not apply() is spread over multiple idle frames.
+    _FORCE_INLINE_ void set_incremental_apply(bool enabled) { incremental_apply = enabled; }
+    // Checks if apply() is spread over multiple idle frames.
+    _FORCE_INLINE_ bool is_incremental_apply() const { return incremental_apply; }
+    // Sets the time budget (in microseconds) per frame for the incremental apply.
+    _FORCE_INLINE_ void set_apply_budget_usec(int usec) { apply_budget_usec = MAX(usec, 1); }
+    // Returns the time budget (in microseconds) per frame for the incremental apply.
+    _FORCE_INLINE_ int get_apply_budget_usec() const { return apply_budget_usec; }
+    // Checks if an apply is in progress.
+    _FORCE_INLINE_ bool is_applying() const { return applying; }
+
+    // Sets the number of threads used to build the region meshes (0 = one per processor).
+    _FORCE_INLINE_ void set_mesh_thread_count(int count) { mesh_thread_count = MAX(count, 0); }
+    // Returns the number of threads used to build the region meshes.
+    _FORCE_INLINE_ int get_mesh_thread_count() const { return mesh_thread_count; }
+
+    // Sets whether or not floor and ceiling tiles are merged into larger quads.
+    _FORCE_INLINE_ void set_merge_floor_tiles(bool enabled) { mark_dirty(); merge_floor_tiles = enabled; }
+    // Checks if floor and ceiling tiles are merged into larger quads.
+    _FORCE_INLINE_ bool is_merge_floor_tiles() const { return merge_floor_tiles; }
+
+    // Sets whether or not straight runs of wall edges are merged into single quads.
+    _FORCE_INLINE_ void set_merge_wall_edges(bool enabled) { mark_dirty(); merge_wall_edges = enabled; }
+    // Checks if straight runs of wall edges are merged into single quads.
+    _FORCE_INLINE_ bool is_merge_wall_edges() const { return merge_wall_edges; }
+
+    // Sets whether or not floor tiles outside of the largest connected component are removed.
+    _FORCE_INLINE_ void set_prune_islands(bool enabled) { mark_dirty(); prune_islands = enabled; }
+    // Checks if floor tiles outside of the largest connected component are removed.
+    _FORCE_INLINE_ bool is_prune_islands() const { return prune_islands; }
+
+    // Sets whether or not the current level stays live while the next one builds.
+    _FORCE_INLINE_ void set_double_buffered(bool enabled) { double_buffered = enabled; }
+    // Checks if the current level stays live while the next one builds.
+    _FORCE_INLINE_ bool is_double_buffered() const { return double_buffered; }
+
+    // Sets whether or not the generation stages are timed.
+    _FORCE_INLINE_ void set_generation_stats_enabled(bool enabled) { stats_enabled = enabled; }
+    // Checks if the generation stages are timed.
+    _FORCE_INLINE_ bool is_generation_stats_enabled() const { return stats_enabled; }
+    // Returns the timings (usec) and memory counters (bytes) of the last generation.
+    Dictionary get_generation_stats() const;
+
     // Set the ceiling height.
     _FORCE_INLINE_ void set_ceiling_height(int height) { ceiling_height = height; }
     // Returns the ceiling height.
     _FORCE_INLINE_ int get_ceiling_height() const { return ceiling_height; }
+    // Sets the distance the bottom of the walls is pushed out.
+    _FORCE_INLINE_ void set_wall_slant(float slant) { mark_dirty(); wall_slant = slant; }
+    // Returns the distance the bottom of the walls is pushed out.
+    _FORCE_INLINE_ float get_wall_slant() const { return wall_slant; }
 
     // Returns the dungeon map builder params.
-    _FORCE_INLINE_ const DungeonMapBuilder::DungeonParams& get_dungeon_params() const { return map_builder.params; }
+    _FORCE_INLINE_ const DungeonMapBuilder::DungeonParams& get_dungeon_params() const { return params; }
 
     // Sets the dungeon seed.
-    _FORCE_INLINE_ void set_dungeon_seed(int64_t seed) { mark_dirty(); map_builder.params.seed = seed; }
+    _FORCE_INLINE_ void set_dungeon_seed(int64_t seed) { mark_dirty(); params.seed = seed; }
     // Returns the dungeon seed.
-    _FORCE_INLINE_ int64_t get_dungeon_seed() const { return map_builder.params.seed; }
+    _FORCE_INLINE_ int64_t get_dungeon_seed() const { return params.seed; }
+
+    // Returns the current level.
+    _FORCE_INLINE_ const Level* get_level() const { return level; }
 
     // Returns all regions in the map.
-    _FORCE_INLINE_ const Map<Vector2, Region*>& get_regions() const { return regions; }
-    // Returns all tiles in the map.
-    _FORCE_INLINE_ const Map<Vector2, Tile*>& get_tiles() const { return tiles; }
+    _FORCE_INLINE_ const DungeonMapPool<Region>& get_regions() const { return level->regions; }
 };
 
+VARIANT_ENUM_CAST(DungeonMap::TileType);
+VARIANT_ENUM_CAST(DungeonMap::GenerationPhase);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include "dungeon_map_benchmark.h"
+#include "dungeon_map.h"
+
+#include <os/os.h>
+
+// Returns the number of triangles in the first surface of a mesh.
+static int _get_triangle_count(const Ref<Mesh>& mesh)
+{
+    if (mesh.is_null() || mesh->get_surface_count() == 0) {
+        return 0;
+    }
+    int index_count = mesh->surface_get_array_index_len(0);
+    if (index_count > 0) {
+        return index_count / 3;
+    }
+    return mesh->surface_get_array_len(0) / 3;
+}
+
+void DungeonMapBenchmark::_begin_phase()
+{
+    phase_start_usec = OS::get_singleton()->get_ticks_usec();
+    phase_start_memory = OS::get_singleton()->get_static_memory_usage();
+}
+
+void DungeonMapBenchmark::_end_phase(Dictionary& phases, Dictionary& memory, const String& name)
+{
+    uint64_t usec = OS::get_singleton()->get_ticks_usec();
+    uint64_t bytes = OS::get_singleton()->get_static_memory_usage();
+
+    phases[name] = (int64_t)(usec - phase_start_usec);
+    memory[name] = (int64_t)bytes - (int64_t)phase_start_memory;
+    _begin_phase();
+}
+
+Dictionary DungeonMapBenchmark::run(const Dictionary& config)
+{
+    DungeonMap* map = memnew(DungeonMap);
+    map->set_dungeon_seed(config.get("seed", map->get_dungeon_seed()));
+    map->set_region_size(config.get("region_size", map->get_region_size()));
+    map->set_tiles_per_region(config.get("tiles_per_region", map->get_tiles_per_region()));
+    map->params.floor_size = config.get("floor_size", map->params.floor_size);
+    map->params.max_floors = config.get("max_floors", map->params.max_floors);
+    map->set_merge_floor_tiles(config.get("merge_floor_tiles", map->is_merge_floor_tiles()));
+    map->set_merge_wall_edges(config.get("merge_wall_edges", map->is_merge_wall_edges()));
+    map->params.dungeon_size = map->region_size * map->params.floor_size * map->tiles_per_region;
+
+    Dictionary phases;
+    Dictionary memory;
+    uint64_t start = OS::get_singleton()->get_ticks_usec();
+
+    // Run the same phases as the map, one at a time.
+    _begin_phase();
+    map->_prepare_next_level();
+    DungeonMap::Level* level = map->next_level;
+    level->map_builder.params = map->params;
+    level->map_builder.create_map_image();
+    level->map_builder.generate_map_image();
+    _end_phase(phases, memory, "walk");
+
+    map->_analyze_connectivity();
+    _end_phase(phases, memory, "connectivity");
+
+    map->_build_regions();
+    _end_phase(phases, memory, "tiles");
+
+    map->_update_tile_neighbors();
+    _end_phase(phases, memory, "neighbors");
+
+    map->_update_wall_distances();
+    _end_phase(phases, memory, "wall_distance");
+
+    map->_build_region_meshes();
+    _end_phase(phases, memory, "meshes");
+
+    map->_build_region_mesh_edges();
+    _end_phase(phases, memory, "edges");
+
+    // Commit the meshes, then build the collision shapes and navigation
+    // meshes from them (nothing is added to a world or the scene tree).
+    for (int i = 0; i < level->regions.size(); i++) {
+        DungeonMap::Region* region = level->regions[i];
+        if (!region->mesh_arrays.is_empty()) {
+            region->mesh = map->_commit_mesh_arrays(region->mesh_arrays);
+        }
+        if (!region->edge_mesh_arrays.is_empty()) {
+            region->edge_mesh = map->_commit_mesh_arrays(region->edge_mesh_arrays);
+        }
+    }
+    _end_phase(phases, memory, "mesh_commit");
+
+    Vector<Ref<Shape> > shapes;
+    for (int i = 0; i < level->regions.size(); i++) {
+        DungeonMap::Region* region = level->regions[i];
+        if (region->mesh.is_valid()) {
+            shapes.push_back(region->mesh->create_trimesh_shape());
+        }
+        if (region->edge_mesh.is_valid()) {
+            shapes.push_back(region->edge_mesh->create_trimesh_shape());
+        }
+    }
+    _end_phase(phases, memory, "collision");
+
+    for (int i = 0; i < level->regions.size(); i++) {
+        DungeonMap::Region* region = level->regions[i];
+        if (region->mesh.is_valid()) {
+            map->_create_region_nav_mesh(region);
+        }
+    }
+    _end_phase(phases, memory, "navmesh");
+    phases["total"] = (int64_t)(OS::get_singleton()->get_ticks_usec() - start);
+
+    // Count what was built.
+    int mesh_triangles = 0;
+    int edge_triangles = 0;
+    int nav_polygons = 0;
+    for (int i = 0; i < level->regions.size(); i++) {
+        DungeonMap::Region* region = level->regions[i];
+        mesh_triangles += _get_triangle_count(region->mesh);
+        edge_triangles += _get_triangle_count(region->edge_mesh);
+        if (region->nav_mesh.is_valid()) {
+            nav_polygons += region->nav_mesh->get_polygon_count();
+        }
+    }
+
+    Dictionary counts;
+    counts["tiles"] = level->get_tile_count();
+    counts["floor_tiles"] = level->valid_tile_count;
+    counts["regions"] = level->regions.size();
+    counts["mesh_triangles"] = mesh_triangles;
+    counts["edge_triangles"] = edge_triangles;
+    counts["collision_shapes"] = shapes.size();
+    counts["navmesh_polygons"] = nav_polygons;
+
+    Dictionary used_config;
+    used_config["seed"] = map->get_dungeon_seed();
+    used_config["region_size"] = map->get_region_size();
+    used_config["tiles_per_region"] = map->get_tiles_per_region();
+    used_config["floor_size"] = map->params.floor_size;
+    used_config["max_floors"] = map->params.max_floors;
+    used_config["merge_floor_tiles"] = map->is_merge_floor_tiles();
+    used_config["merge_wall_edges"] = map->is_merge_wall_edges();
+
+    Dictionary result;
+    result["config"] = used_config;
+    result["phases"] = phases;
+    result["memory"] = memory;
+    result["counts"] = counts;
+
+    shapes.clear();
+    map->_clear_level(level);
+    memdelete(map);
+    return result;
+}
+
+void DungeonMapBenchmark::_bind_methods()
+{
+    ClassDB::bind_method(D_METHOD("run", "config"), &DungeonMapBenchmark::run);
+}
+
+DungeonMapBenchmark::DungeonMapBenchmark()
+{
+
+}
@@ -0,0 +1,63 @@
+/**********************************************************
+ * Author:  Victor Holt
+ * The MIT License (MIT)
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ **********************************************************/
+
+#ifndef DUNGEON_MAP_BENCHMARK_H
+#define DUNGEON_MAP_BENCHMARK_H
+#include <reference.h>
+
+class DungeonMap;
+
+// Runs the dungeon generation pipeline outside of the scene tree and
+// measures every phase. Used by scripts/Benchmark.gd to sweep the map
+// parameters headless (--no-window or the server platform).
+class DungeonMapBenchmark : public Reference
+{
+    GDCLASS(DungeonMapBenchmark, Reference);
+
+    // Time (usec) and static memory (bytes) at the start of the current phase.
+    uint64_t phase_start_usec = 0;
+    uint64_t phase_start_memory = 0;
+
+    // Starts timing a phase.
+    void _begin_phase();
+    // Records the time and memory of the current phase and starts the next one.
+    void _end_phase(Dictionary& phases, Dictionary& memory, const String& name);
+
+protected:
+    // Binds methods for the benchmark.
+    static void _bind_methods();
+
+public:
+    // Constructor.
+    DungeonMapBenchmark();
+
+    // Generates and builds a single dungeon with the given configuration
+    // (seed, region_size, tiles_per_region, floor_size, max_floors) and
+    // returns the per-phase wall time in microseconds, the static memory
+    // allocated by each phase in bytes (debug builds only) and the
+    // tile/triangle counts.
+    Dictionary run(const Dictionary& config);
+};
+
+#endif
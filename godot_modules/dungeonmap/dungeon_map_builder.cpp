@@ -3,17 +3,20 @@
 #include <print_string.h>
 #include <servers/physics_server.h>
 
+#include <string.h>
+
 void DungeonMapBuilder::generate_map_image()
 {
-    Math::seed(params.seed);
+    rng.seed((uint64_t)params.seed);
 
     // Reset our params.
     params.floors_placed = 0;
     params.lower_bound = Vector2(0, 0);
     params.upper_bound = Vector2(0, 0);
 
-    // Clear the image.
-    if (!map_image.is_valid()) {
+    // Clear the grid.
+    int grid_size = params.dungeon_size / params.floor_size;
+    if (grid.get_width() != grid_size || grid.get_height() != grid_size) {
         create_map_image();
     } else {
         clear_map_image();
@@ -21,64 +24,100 @@ void DungeonMapBuilder::generate_map_image()
 
     _build_floors();
 
-    // Update our map texture.
-    map_texture->set_data(map_image);
+    // The image will be rebuilt from the grid when requested.
+    image_dirty = true;
 }
 
 void DungeonMapBuilder::create_map_image()
 {
-    if (map_image.is_valid()) {
-        map_image.unref();
-    }
-    if (map_texture.is_valid()) {
-        map_texture.unref();
-    }
-
-    Ref<Image> img = memnew(Image(
-        params.dungeon_size,
-        params.dungeon_size,
-        false,
-        Image::FORMAT_RGB8
-    ));
-
-    map_image = img;
-
-    Ref<ImageTexture> tex = memnew(ImageTexture);
-    tex->create_from_image(map_image);
-    map_texture = tex;
+    int grid_size = params.dungeon_size / params.floor_size;
+    grid.resize(grid_size, grid_size);
+    image_dirty = true;
 }
 
 void DungeonMapBuilder::clear_map_image()
 {
-    if (!map_image.is_valid()) {
+    grid.clear();
+    image_dirty = true;
+}
+
+void DungeonMapBuilder::set_map_tile_color(const Vector2& tile_id, Color color)
+{
+    Ref<Image> image = get_map_image();
+    if (image.is_null()) {
         return;
     }
 
-    int w = map_image->get_width();
-    int h = map_image->get_height();
-
-    map_image->lock();
-    for (int x = 0; x < w; x++) {
-        for (int y = 0; y < h; y++) {
-            map_image->set_pixel(x, y, Color(0, 0, 0));
+    image->lock();
+    for (int x = 0; x < params.floor_size; x++) {
+        for (int y = 0; y < params.floor_size; y++) {
+            image->set_pixel((int)tile_id.x + x, (int)(tile_id.y * -1.0f) + y, color);
         }
     }
-    map_image->unlock();
+    image->unlock();
+    map_texture->set_data(image);
+}
 
-    // Update the texture.
-    map_texture->set_data(map_image);
+Ref<Image> DungeonMapBuilder::get_map_image()
+{
+    if (image_dirty || map_image.is_null()) {
+        _update_map_image();
+    }
+    return map_image;
 }
 
-void DungeonMapBuilder::set_map_tile_color(const Vector2& tile_id, Color color)
+Ref<ImageTexture> DungeonMapBuilder::get_map_texture()
 {
-    map_image->lock();
-    for (int x = 0; x < params.floor_size; x++) {
-        for (int y = 0; y < params.floor_size; y++) {
-            map_image->set_pixel((int)tile_id.x + x, (int)(tile_id.y * -1.0f) + y, color);
+    if (image_dirty || map_texture.is_null()) {
+        _update_map_image();
+    }
+    return map_texture;
+}
+
+void DungeonMapBuilder::_update_map_image()
+{
+    image_dirty = false;
+
+    int size = params.dungeon_size;
+    int tile_size = params.floor_size;
+    int row_bytes = size * 3;
+    if (size <= 0 || tile_size <= 0) {
+        return;
+    }
+
+    // Expand each tile bit into a floor_size x floor_size block of pixels.
+    PoolVector<uint8_t> data;
+    data.resize(row_bytes * size);
+    {
+        PoolVector<uint8_t>::Write w = data.write();
+        uint8_t* pixels = w.ptr();
+        memset(pixels, 0, data.size());
+
+        for (int ty = 0; ty < grid.get_height(); ty++) {
+            uint8_t* row = pixels + (ty * tile_size) * row_bytes;
+            for (int tx = 0; tx < grid.get_width(); tx++) {
+                if (grid.get(tx, ty)) {
+                    memset(row + (tx * tile_size * 3), 255, tile_size * 3);
+                }
+            }
+
+            // Copy the first row of pixels to the rest of the tile.
+            for (int y = 1; y < tile_size && (ty * tile_size) + y < size; y++) {
+                memcpy(row + (y * row_bytes), row, row_bytes);
+            }
         }
     }
-    map_image->unlock();
-    map_texture->set_data(map_image);
+
+    Ref<Image> img = memnew(Image(size, size, false, Image::FORMAT_RGB8, data));
+    map_image = img;
+
+    if (map_texture.is_valid() && map_texture->get_width() == size && map_texture->get_height() == size) {
+        map_texture->set_data(map_image);
+    } else {
+        Ref<ImageTexture> tex = memnew(ImageTexture);
+        tex->create_from_image(map_image);
+        map_texture = tex;
+    }
 }
 
 void DungeonMapBuilder::_build_floors()
@@ -88,13 +127,10 @@ void DungeonMapBuilder::_build_floors()
     }
     params.is_generating = true;
 
-    int w = map_image->get_width();
-    int h = map_image->get_height();
-
     // Set the initial position.
     //Math::randomize();
-    params.rand_x = Math::random(0, params.dungeon_size - params.floor_size);
-    params.rand_y = Math::random(0, params.dungeon_size - params.floor_size);
+    params.rand_x = rng.random(0, params.dungeon_size - params.floor_size);
+    params.rand_y = rng.random(0, params.dungeon_size - params.floor_size);
 
     params.current_x = params.rand_x - (params.rand_x % params.floor_size);
     params.current_y = params.rand_y - (params.rand_y % params.floor_size);
@@ -116,20 +152,14 @@ void DungeonMapBuilder::_build_floors()
 
 void DungeonMapBuilder::_place_floor()
 {
-    // Add our floor tile to the image.
-    map_image->lock();
-    for (int x = 0; x < params.floor_size; x++) {
-        for (int y = 0; y < params.floor_size; y++) {
-            map_image->set_pixel(params.current_x + x, params.current_y + y, Color(1, 1, 1));
-        }
-    }
-    map_image->unlock();
+    // Add our floor tile to the grid.
+    grid.set(params.current_x / params.floor_size, params.current_y / params.floor_size, true);
 
     // Increment the number of floors.
     params.floors_placed += 1;
 
     // Determine the next location for the floor tile.
-    params.dir = Math::random(0, 5);
+    params.dir = rng.random(0, 4);
     switch (params.dir) {
         case 1:
             params.current_x += params.floor_size;
@@ -28,6 +28,9 @@
 #include <image.h>
 #include <scene/resources/texture.h>
 
+#include "dungeon_map_grid.h"
+#include "dungeon_map_random.h"
+
 class DungeonMapBuilder
 {
 public:
@@ -63,12 +66,18 @@ public:
     };
 
 private:
-    // Image of the map.
+    // Occupancy grid of the map, one bit per floor tile.
+    DungeonMapGrid grid;
+    // Random generator for the floor walk (seeded from params.seed).
+    DungeonMapRandom rng;
+    // Image of the map (built from the grid when requested).
     Ref<Image> map_image;
     // Texture for the map.
     Ref<ImageTexture> map_texture;
     // Flag for whether or not the dungeon is dirty.
     bool dirty = true;
+    // Flag for whether or not the image needs to be rebuilt from the grid.
+    bool image_dirty = true;
 
     // Build the floors.
     void _build_floors();
@@ -78,6 +87,9 @@ private:
     // Check if we need to update the bounds.
     void _update_bounds();
 
+    // Rebuilds the map image/texture from the occupancy grid.
+    void _update_map_image();
+
 public:
     // Dungeon generating parameters.
     DungeonParams params;
@@ -87,21 +99,30 @@ public:
     // Destructor.
     virtual ~DungeonMapBuilder();
 
-    // Create the map image.
+    // Create the map grid.
     void create_map_image();
-    // Clears the map image.
+    // Clears the map grid.
     void clear_map_image();
 
-    // Generates the map image.
+    // Generates the map grid.
     void generate_map_image();
 
     // Set the map image color for a specific tile.
     void set_map_tile_color(const Vector2& tile_id, Color color);
 
-    // Returns the map image.
-    _FORCE_INLINE_ Ref<Image> get_map_image() const { return map_image; }
-    // Returns the map texture.
-    _FORCE_INLINE_ Ref<ImageTexture> get_map_texture() const { return map_texture; }
+    // Returns the map image, building it from the grid if needed.
+    Ref<Image> get_map_image();
+    // Returns the map texture, building it from the grid if needed.
+    Ref<ImageTexture> get_map_texture();
+
+    // Returns the occupancy grid.
+    _FORCE_INLINE_ const DungeonMapGrid& get_grid() const { return grid; }
+    // Sets whether or not a tile is a floor tile.
+    _FORCE_INLINE_ void set_floor_tile(int x, int y, bool floor)
+    {
+        grid.set(x, y, floor);
+        image_dirty = true;
+    }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,215 @@
+#include "dungeon_map_connectivity.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Returns the index of the lowest set bit of a non-zero word.
+static _FORCE_INLINE_ int _lowest_bit(uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return (int)index;
+#else
+    int index = 0;
+    while (!(word & 1)) {
+        word >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+int DungeonMapConnectivity::_find(int run)
+{
+    Run* data = runs.ptrw();
+    while (data[run].parent != run) {
+        data[run].parent = data[data[run].parent].parent;
+        run = data[run].parent;
+    }
+    return run;
+}
+
+void DungeonMapConnectivity::_union(int a, int b)
+{
+    a = _find(a);
+    b = _find(b);
+    if (a == b) {
+        return;
+    }
+    // Keep the earlier run as the root so components are numbered in scan order.
+    if (a < b) {
+        runs[b].parent = a;
+    } else {
+        runs[a].parent = b;
+    }
+}
+
+void DungeonMapConnectivity::_add_row_runs(const DungeonMapGrid& grid, int y, int width)
+{
+    const uint64_t* row = grid.get_row(y);
+    int words = (width + 63) >> 6;
+    // Start of the run continuing into the next word (-1 if none).
+    int open_start = -1;
+
+    for (int w = 0; w < words; w++) {
+        uint64_t word = row[w];
+        int base = w << 6;
+        if (base + 64 > width) {
+            word &= ((uint64_t)1 << (width - base)) - 1;
+        }
+
+        int pos = 0;
+        while (pos < 64) {
+            uint64_t rest = word >> pos;
+            if (open_start < 0) {
+                if (!rest) {
+                    break;
+                }
+                pos += _lowest_bit(rest);
+                open_start = base + pos;
+                rest = word >> pos;
+            }
+            // The run ends at the first clear bit, the bits shifted in are clear.
+            pos += (~rest) ? _lowest_bit(~rest) : 64;
+            if (pos < 64) {
+                Run run = { y, open_start, base + pos - 1, runs.size() };
+                runs.push_back(run);
+                open_start = -1;
+            }
+        }
+    }
+    if (open_start >= 0) {
+        Run run = { y, open_start, width - 1, runs.size() };
+        runs.push_back(run);
+    }
+}
+
+void DungeonMapConnectivity::analyze(const DungeonMapGrid& grid, int width, int height)
+{
+    runs.clear();
+    components.clear();
+    largest = -1;
+    tile_count = 0;
+
+    width = MIN(width, grid.get_width());
+    height = MIN(height, grid.get_height());
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+
+    // Runs of the previous row.
+    int prev_begin = 0;
+    int prev_end = 0;
+    for (int y = 0; y < height; y++) {
+        int row_begin = runs.size();
+        _add_row_runs(grid, y, width);
+        int row_end = runs.size();
+
+        // Both rows are sorted, join the overlapping runs in a single sweep.
+        int i = prev_begin;
+        int j = row_begin;
+        while (i < prev_end && j < row_end) {
+            const Run& above = runs[i];
+            const Run& run = runs[j];
+            if (above.start <= run.end && run.start <= above.end) {
+                _union(i, j);
+            }
+            if (above.end < run.end) {
+                i++;
+            } else {
+                j++;
+            }
+        }
+
+        prev_begin = row_begin;
+        prev_end = row_end;
+    }
+
+    // Number the roots and gather the size and bounds of each component.
+    Vector<int> labels;
+    labels.resize(runs.size());
+    for (int i = 0; i < runs.size(); i++) {
+        int root = _find(i);
+        if (root == i) {
+            Component component = { 0, runs[i].start, runs[i].y, runs[i].end, runs[i].y };
+            labels[i] = components.size();
+            components.push_back(component);
+        } else {
+            // Roots come before the runs of their set.
+            labels[i] = labels[root];
+        }
+
+        const Run& run = runs[i];
+        Component& component = components[labels[i]];
+        component.size += run.end - run.start + 1;
+        component.min_x = MIN(component.min_x, run.start);
+        component.max_x = MAX(component.max_x, run.end);
+        component.max_y = run.y;
+    }
+    for (int i = 0; i < runs.size(); i++) {
+        runs[i].parent = labels[i];
+    }
+
+    for (int i = 0; i < components.size(); i++) {
+        tile_count += components[i].size;
+        if (largest < 0 || components[i].size > components[largest].size) {
+            largest = i;
+        }
+    }
+}
+
+int DungeonMapConnectivity::prune(DungeonMapGrid& grid)
+{
+    if (components.size() <= 1) {
+        return 0;
+    }
+
+    // Clear the runs of the other components and keep the runs of the largest.
+    int kept = 0;
+    for (int i = 0; i < runs.size(); i++) {
+        const Run& run = runs[i];
+        if (run.parent != largest) {
+            grid.clear_span(run.y, run.start, run.end);
+            continue;
+        }
+        runs[kept] = run;
+        runs[kept].parent = 0;
+        kept++;
+    }
+    runs.resize(kept);
+
+    Component component = components[largest];
+    int removed = tile_count - component.size;
+    components.clear();
+    components.push_back(component);
+    largest = 0;
+    tile_count = component.size;
+    return removed;
+}
+
+Dictionary DungeonMapConnectivity::to_dictionary() const
+{
+    Array sizes;
+    Array bounding_boxes;
+    for (int i = 0; i < components.size(); i++) {
+        const Component& component = components[i];
+        sizes.push_back(component.size);
+        bounding_boxes.push_back(Rect2(
+            component.min_x, component.min_y,
+            component.max_x - component.min_x + 1, component.max_y - component.min_y + 1
+        ));
+    }
+
+    Dictionary stats;
+    stats["component_count"] = components.size();
+    stats["largest_component"] = largest;
+    stats["largest_component_size"] = largest >= 0 ? components[largest].size : 0;
+    stats["tile_count"] = tile_count;
+    stats["component_sizes"] = sizes;
+    stats["bounding_boxes"] = bounding_boxes;
+    return stats;
+}
@@ -0,0 +1,104 @@
+/**********************************************************
+ * Author:  Victor Holt
+ * The MIT License (MIT)
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ **********************************************************/
+
+#ifndef DUNGEON_MAP_CONNECTIVITY_H
+#define DUNGEON_MAP_CONNECTIVITY_H
+#include <typedefs.h>
+#include <vector.h>
+#include <dictionary.h>
+#include <variant.h>
+
+#include "dungeon_map_grid.h"
+
+// Connected components (4-connected) of the occupied tiles of a grid.
+// Each row is split into runs of occupied tiles straight from the grid
+// words, and runs overlapping a run of the previous row are joined with a
+// union-find, so the cost follows the number of runs rather than tiles.
+class DungeonMapConnectivity
+{
+public:
+    // A connected component.
+    struct Component
+    {
+        // Number of tiles.
+        int size;
+        // Bounding box in tile coordinates (inclusive).
+        int min_x;
+        int min_y;
+        int max_x;
+        int max_y;
+    };
+
+private:
+    // A horizontal run of occupied tiles.
+    struct Run
+    {
+        // Row and first/last column of the run.
+        int y;
+        int start;
+        int end;
+        // Union-find parent (a run index), the component after labelling.
+        int parent;
+    };
+
+    // Runs of every row, in row order.
+    Vector<Run> runs;
+    // Components, in order of their first run.
+    Vector<Component> components;
+    // Index of the largest component (-1 if there are no tiles).
+    int largest = -1;
+    // Number of occupied tiles.
+    int tile_count = 0;
+
+    // Returns the root run of a run (halving the path on the way).
+    int _find(int run);
+    // Joins the sets of two runs.
+    void _union(int a, int b);
+    // Appends the runs of a row.
+    void _add_row_runs(const DungeonMapGrid& grid, int y, int width);
+
+public:
+    // Labels the components of the grid's tiles within width x height.
+    void analyze(const DungeonMapGrid& grid, int width, int height);
+    // Clears every tile outside of the largest component from the grid,
+    // which must be the one that was analyzed. Returns the number of tiles
+    // cleared, only the largest component is left afterwards.
+    int prune(DungeonMapGrid& grid);
+
+    // Returns the number of components.
+    _FORCE_INLINE_ int get_component_count() const { return components.size(); }
+    // Returns a component.
+    _FORCE_INLINE_ const Component& get_component(int index) const { return components[index]; }
+    // Returns the index of the largest component (-1 if there are no tiles).
+    _FORCE_INLINE_ int get_largest_component() const { return largest; }
+    // Returns the number of occupied tiles.
+    _FORCE_INLINE_ int get_tile_count() const { return tile_count; }
+    // Returns the number of bytes used by the runs and components.
+    _FORCE_INLINE_ int get_memory_usage() const { return runs.size() * sizeof(Run) + components.size() * sizeof(Component); }
+
+    // Returns the component count, sizes and bounding boxes as a Dictionary.
+    Dictionary to_dictionary() const;
+};
+
+#endif
@@ -72,8 +72,9 @@ void DungeonMapDebugRenderer::update()
     debug_tile_material->set_feature(SpatialMaterial::FEATURE_TRANSPARENT, true);
 
     // Build instances/meshes.
-    for (Map<Vector2, DungeonMap::Region*>::Element* e = parent->get_regions().front(); e; e = e->next()) {
-        auto region = e->get();
+    const DungeonMapPool<DungeonMap::Region>& regions = parent->get_regions();
+    for (int i = 0; i < regions.size(); i++) {
+        DungeonMap::Region* region = regions[i];
 
         // Create the debug render aabb instance.
         RID mesh_instance = DungeonMapMeshBuilder::create_mesh_from_aabb(region->aabb);
@@ -92,11 +93,12 @@ void DungeonMapDebugRenderer::update()
     }
 
     // Build instances/meshes.
-    for (Map<Vector2, DungeonMap::Tile*>::Element* e = parent->get_tiles().front(); e; e = e->next()) {
-        auto tile = e->get();
+    const DungeonMap::Level* level = parent->get_level();
+    for (int i = 0; i < level->get_tile_count(); i++) {
+        Vector2 tile_id = level->get_tile_id(i);
 
         // Create the debug render aabb instance.
-        RID mesh_instance = DungeonMapMeshBuilder::create_mesh_lines_from_aabb(tile->aabb);
+        RID mesh_instance = DungeonMapMeshBuilder::create_mesh_lines_from_aabb(level->get_tile_aabb(i));
         VS::get_singleton()->mesh_surface_set_material(
             mesh_instance,
             0,
@@ -104,11 +106,10 @@ void DungeonMapDebugRenderer::update()
         );
         RID instance = VS::get_singleton()->instance_create2(mesh_instance, get_world()->get_scenario());
 
-        VS::get_singleton()->instance_set_transform(instance, tile->transform);
         VS::get_singleton()->instance_set_visible(instance, false);
 
-        tile_instances[tile->id] = instance;
-        tile_meshes[tile->id] = mesh_instance;
+        tile_instances[tile_id] = instance;
+        tile_meshes[tile_id] = mesh_instance;
     }
 }
 
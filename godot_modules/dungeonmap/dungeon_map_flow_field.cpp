@@ -0,0 +1,177 @@
+#include "dungeon_map_flow_field.h"
+
+#include <string.h>
+
+// Tile offsets of each direction (same order as DungeonMap::Neighbor, north is +y).
+static const int flow_offsets[8][2] = {
+    { 0, 1 }, { 1, 0 }, { 0, -1 }, { -1, 0 },
+    { 1, 1 }, { -1, 1 }, { 1, -1 }, { -1, -1 }
+};
+
+bool DungeonMapFlowField::update(const DungeonMapPathFinder::Grid& grid, const Vector<int>& goal_tiles, int max_radius)
+{
+    int tile_count = grid.width * grid.height;
+    max_radius = CLAMP(max_radius, 0, UNREACHED - 1);
+
+    // Only the goal tiles matter, agents moving within a tile reuse the field.
+    if (distances.size() == tile_count && radius == max_radius && goals.size() == goal_tiles.size()) {
+        bool same = true;
+        for (int i = 0; i < goals.size() && same; i++) {
+            same = goals[i] == goal_tiles[i];
+        }
+        if (same) {
+            return false;
+        }
+    }
+    goals = goal_tiles;
+    radius = max_radius;
+
+    // Reset the tiles of the last update (or everything when the grid changed).
+    uint16_t* tile_distances;
+    uint8_t* tile_directions;
+    if (distances.size() != tile_count) {
+        distances.resize(tile_count);
+        directions.resize(tile_count);
+        tile_distances = distances.ptrw();
+        tile_directions = directions.ptrw();
+        for (int i = 0; i < tile_count; i++) {
+            tile_distances[i] = UNREACHED;
+        }
+        memset(tile_directions, NO_DIRECTION, tile_count);
+    } else {
+        tile_distances = distances.ptrw();
+        tile_directions = directions.ptrw();
+        const int* tiles = reached.ptr();
+        for (int i = 0; i < reached.size(); i++) {
+            tile_distances[tiles[i]] = UNREACHED;
+            tile_directions[tiles[i]] = NO_DIRECTION;
+        }
+    }
+    reached.clear();
+
+    for (int i = 0; i < goals.size(); i++) {
+        int goal = goals[i];
+        if (goal < 0 || goal >= tile_count || grid.types[goal] == 0 || tile_distances[goal] != UNREACHED) {
+            continue;
+        }
+        tile_distances[goal] = 0;
+        reached.push_back(goal);
+    }
+
+    // Breadth first over the 4-connected tiles, reached doubles as the queue.
+    for (int head = 0; head < reached.size(); head++) {
+        int index = reached[head];
+        uint16_t distance = tile_distances[index];
+        if (distance >= radius) {
+            continue;
+        }
+        int x = index % grid.width;
+        int y = index / grid.width;
+        for (int n = 0; n < 4; n++) {
+            int nx = x + flow_offsets[n][0];
+            int ny = y + flow_offsets[n][1];
+            if (!grid.is_walkable(nx, ny)) {
+                continue;
+            }
+            int neighbor = ny * grid.width + nx;
+            if (tile_distances[neighbor] == UNREACHED) {
+                tile_distances[neighbor] = distance + 1;
+                reached.push_back(neighbor);
+            }
+        }
+    }
+
+    // Point every tile at its closest neighbor. Diagonals (two steps closer)
+    // win over straight moves, but never cut corners.
+    const int* tiles = reached.ptr();
+    for (int i = 0; i < reached.size(); i++) {
+        int index = tiles[i];
+        uint16_t best = tile_distances[index];
+        if (best == 0) {
+            continue;
+        }
+        int x = index % grid.width;
+        int y = index / grid.width;
+        for (int n = 0; n < 8; n++) {
+            int nx = x + flow_offsets[n][0];
+            int ny = y + flow_offsets[n][1];
+            if (!grid.is_walkable(nx, ny)) {
+                continue;
+            }
+            if (n >= 4 && (!grid.is_walkable(nx, y) || !grid.is_walkable(x, ny))) {
+                continue;
+            }
+            uint16_t distance = tile_distances[ny * grid.width + nx];
+            if (distance < best) {
+                best = distance;
+                tile_directions[index] = n;
+            }
+        }
+    }
+    return true;
+}
+
+void DungeonMapFlowField::clear()
+{
+    distances.clear();
+    directions.clear();
+    reached.clear();
+    goals.clear();
+    radius = 0;
+}
+
+void DungeonMapFlowField::get_direction_offset(uint8_t direction, int& dx, int& dy)
+{
+    if (direction >= 8) {
+        dx = 0;
+        dy = 0;
+        return;
+    }
+    dx = flow_offsets[direction][0];
+    dy = flow_offsets[direction][1];
+}
+
+bool DungeonMapFlowField::get_path(const DungeonMapPathFinder::Grid& grid, int from, bool allow_diagonal, Vector<int>& path) const
+{
+    path.clear();
+    if (get_distance(from) == UNREACHED || distances.size() != grid.width * grid.height) {
+        return false;
+    }
+
+    int index = from;
+    int last_dx = 0;
+    int last_dy = 0;
+    path.push_back(from);
+    while (distances[index] > 0) {
+        int x = index % grid.width;
+        int y = index / grid.width;
+        int dx = 0;
+        int dy = 0;
+        if (allow_diagonal) {
+            get_direction_offset(directions[index], dx, dy);
+        } else {
+            // Any straight neighbor one step closer (the breadth first parent is one).
+            for (int n = 0; n < 4; n++) {
+                int nx = x + flow_offsets[n][0];
+                int ny = y + flow_offsets[n][1];
+                if (grid.is_walkable(nx, ny) && distances[ny * grid.width + nx] == distances[index] - 1) {
+                    dx = flow_offsets[n][0];
+                    dy = flow_offsets[n][1];
+                    break;
+                }
+            }
+        }
+
+        // Only the turns are kept.
+        if (index != from && (dx != last_dx || dy != last_dy)) {
+            path.push_back(index);
+        }
+        last_dx = dx;
+        last_dy = dy;
+        index += dy * grid.width + dx;
+    }
+    if (index != from) {
+        path.push_back(index);
+    }
+    return true;
+}
@@ -0,0 +1,80 @@
+/**********************************************************
+ * Author:  Victor Holt
+ * The MIT License (MIT)
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ **********************************************************/
+
+#ifndef DUNGEON_MAP_FLOW_FIELD_H
+#define DUNGEON_MAP_FLOW_FIELD_H
+#include <typedefs.h>
+#include <vector.h>
+
+#include "dungeon_map_path_finder.h"
+
+// Distance and direction towards the nearest of a set of goal tiles, for
+// every walkable tile within a radius of the goals. Agents chasing the same
+// goals share one field instead of searching a path each.
+class DungeonMapFlowField
+{
+    // Distance (in 4-connected steps) from each tile to the nearest goal.
+    Vector<uint16_t> distances;
+    // Neighbor (DungeonMap::Neighbor order) to move to from each tile.
+    Vector<uint8_t> directions;
+    // Tiles reached by the last update, in the order they were reached.
+    Vector<int> reached;
+    // Goal tiles of the last update.
+    Vector<int> goals;
+    // Radius of the last update.
+    int radius = 0;
+
+public:
+    // Value of unreached tiles in the distances.
+    static const uint16_t UNREACHED = 0xffff;
+    // Value of tiles without a direction (goals and unreached tiles).
+    static const uint8_t NO_DIRECTION = 0xff;
+
+    // Rebuilds the field for the goal tiles, spreading out at most radius
+    // steps. Does nothing (and returns false) if the goals and radius are
+    // the same as in the last update.
+    bool update(const DungeonMapPathFinder::Grid& grid, const Vector<int>& goal_tiles, int max_radius);
+    // Empties the field.
+    void clear();
+
+    // Returns the distance from a tile to the nearest goal (UNREACHED if it's out of reach).
+    _FORCE_INLINE_ uint16_t get_distance(int index) const
+    {
+        return (index >= 0 && index < distances.size()) ? distances[index] : UNREACHED;
+    }
+    // Returns the neighbor to move to from a tile (NO_DIRECTION for goals and unreached tiles).
+    _FORCE_INLINE_ uint8_t get_direction(int index) const
+    {
+        return (index >= 0 && index < directions.size()) ? directions[index] : NO_DIRECTION;
+    }
+    // Returns the tile offset of a direction.
+    static void get_direction_offset(uint8_t direction, int& dx, int& dy);
+
+    // Walks the field from a tile down to the nearest goal. The tiles at
+    // each turn of the walk (including both ends) are written to path.
+    // Diagonal moves are only taken if allow_diagonal is set.
+    bool get_path(const DungeonMapPathFinder::Grid& grid, int from, bool allow_diagonal, Vector<int>& path) const;
+};
+
+#endif
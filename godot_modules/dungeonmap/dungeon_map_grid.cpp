@@ -0,0 +1,193 @@
+#include "dungeon_map_grid.h"
+
+#include <string.h>
+
+void DungeonMapGrid::resize(int p_width, int p_height)
+{
+    width = MAX(p_width, 0);
+    height = MAX(p_height, 0);
+    words_per_row = (width + 63) >> 6;
+
+    bits.resize(words_per_row * height);
+    clear();
+}
+
+void DungeonMapGrid::clear()
+{
+    if (bits.size() == 0) {
+        return;
+    }
+    memset(bits.ptrw(), 0, bits.size() * sizeof(uint64_t));
+}
+
+int DungeonMapGrid::count() const
+{
+    int total = 0;
+    const uint64_t* words = bits.ptr();
+    for (int i = 0; i < bits.size(); i++) {
+        uint64_t word = words[i];
+        // Clear the lowest set bit until the word is empty.
+        while (word) {
+            word &= word - 1;
+            total++;
+        }
+    }
+    return total;
+}
+
+void DungeonMapGrid::clear_span(int y, int start, int end)
+{
+    if (y < 0 || y >= height) {
+        return;
+    }
+    start = MAX(start, 0);
+    end = MIN(end, width - 1);
+
+    uint64_t* row = bits.ptrw() + y * words_per_row;
+    while (start <= end) {
+        int w = start >> 6;
+        int last = MIN(end, (w << 6) + 63);
+        // Bits start..last of the word.
+        int count = last - start + 1;
+        uint64_t mask = (count == 64) ? ~(uint64_t)0 : (((uint64_t)1 << count) - 1) << (start & 63);
+        row[w] &= ~mask;
+        start = last + 1;
+    }
+}
+
+// Number of neighbor planes (one per neighbor direction).
+#define NEIGHBOR_PLANES 8
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+// Expands 64 tiles worth of neighbor planes into one mask byte per tile.
+static _FORCE_INLINE_ void _expand_planes(const uint64_t* planes, uint8_t* out)
+{
+    // Byte i selects bit (i % 8) of the broadcast plane byte.
+    const __m256i select = _mm256_set1_epi64x(0x8040201008040201ULL);
+    const uint64_t broadcast = 0x0101010101010101ULL;
+
+    for (int chunk = 0; chunk < 64; chunk += 32) {
+        __m256i acc = _mm256_setzero_si256();
+        for (int n = 0; n < NEIGHBOR_PLANES; n++) {
+            uint64_t bits = planes[n] >> chunk;
+            __m256i v = _mm256_set_epi64x(
+                ((bits >> 24) & 0xff) * broadcast,
+                ((bits >> 16) & 0xff) * broadcast,
+                ((bits >> 8) & 0xff) * broadcast,
+                (bits & 0xff) * broadcast
+            );
+            __m256i set = _mm256_cmpeq_epi8(_mm256_and_si256(v, select), select);
+            acc = _mm256_or_si256(acc, _mm256_and_si256(set, _mm256_set1_epi8((char)(1 << n))));
+        }
+        _mm256_storeu_si256((__m256i*)(out + chunk), acc);
+    }
+}
+
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+
+// Expands 64 tiles worth of neighbor planes into one mask byte per tile.
+static _FORCE_INLINE_ void _expand_planes(const uint64_t* planes, uint8_t* out)
+{
+    // Byte i selects bit (i % 8) of the broadcast plane byte.
+    const __m128i select = _mm_set_epi32(0x80402010, 0x08040201, 0x80402010, 0x08040201);
+    const uint64_t broadcast = 0x0101010101010101ULL;
+
+    for (int chunk = 0; chunk < 64; chunk += 16) {
+        __m128i acc = _mm_setzero_si128();
+        for (int n = 0; n < NEIGHBOR_PLANES; n++) {
+            uint64_t bits = planes[n] >> chunk;
+            __m128i v = _mm_set_epi64x(
+                ((bits >> 8) & 0xff) * broadcast,
+                (bits & 0xff) * broadcast
+            );
+            __m128i set = _mm_cmpeq_epi8(_mm_and_si128(v, select), select);
+            acc = _mm_or_si128(acc, _mm_and_si128(set, _mm_set1_epi8((char)(1 << n))));
+        }
+        _mm_storeu_si128((__m128i*)(out + chunk), acc);
+    }
+}
+
+#else
+
+// Transposes an 8x8 bit matrix stored one row per byte.
+static _FORCE_INLINE_ uint64_t _transpose8x8(uint64_t x)
+{
+    uint64_t t;
+    t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+    x = x ^ t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+    x = x ^ t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+    x = x ^ t ^ (t << 28);
+    return x;
+}
+
+// Expands 64 tiles worth of neighbor planes into one mask byte per tile.
+static _FORCE_INLINE_ void _expand_planes(const uint64_t* planes, uint8_t* out)
+{
+    for (int chunk = 0; chunk < 64; chunk += 8) {
+        // Row n of the matrix holds 8 tiles of plane n, the transpose
+        // holds the mask of each tile.
+        uint64_t matrix = 0;
+        for (int n = 0; n < NEIGHBOR_PLANES; n++) {
+            matrix |= ((planes[n] >> chunk) & 0xff) << (n * 8);
+        }
+        matrix = _transpose8x8(matrix);
+        for (int i = 0; i < 8; i++) {
+            out[chunk + i] = (uint8_t)(matrix >> (i * 8));
+        }
+    }
+}
+
+#endif
+
+void DungeonMapGrid::compute_neighbor_masks(uint8_t* masks, int stride) const
+{
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    // One row of masks, padded to whole words.
+    Vector<uint8_t> row_masks;
+    row_masks.resize(words_per_row * 64);
+    uint8_t* out = row_masks.ptrw();
+
+    for (int y = 0; y < height; y++) {
+        const uint64_t* row = get_row(y);
+        const uint64_t* north = (y + 1 < height) ? get_row(y + 1) : NULL;
+        const uint64_t* south = (y > 0) ? get_row(y - 1) : NULL;
+
+        for (int w = 0; w < words_per_row; w++) {
+            bool has_prev = w > 0;
+            bool has_next = w + 1 < words_per_row;
+
+            // Each row and its neighboring words (for the bits shifted across words).
+            uint64_t c = row[w];
+            uint64_t c_prev = has_prev ? row[w - 1] : 0;
+            uint64_t c_next = has_next ? row[w + 1] : 0;
+            uint64_t n = north ? north[w] : 0;
+            uint64_t n_prev = (north && has_prev) ? north[w - 1] : 0;
+            uint64_t n_next = (north && has_next) ? north[w + 1] : 0;
+            uint64_t s = south ? south[w] : 0;
+            uint64_t s_prev = (south && has_prev) ? south[w - 1] : 0;
+            uint64_t s_next = (south && has_next) ? south[w + 1] : 0;
+
+            // Bit x of each plane is the occupancy of that neighbor of tile x.
+            uint64_t planes[NEIGHBOR_PLANES] = {
+                n,
+                (c >> 1) | (c_next << 63),
+                s,
+                (c << 1) | (c_prev >> 63),
+                (n >> 1) | (n_next << 63),
+                (n << 1) | (n_prev >> 63),
+                (s >> 1) | (s_next << 63),
+                (s << 1) | (s_prev >> 63)
+            };
+            _expand_planes(planes, out + w * 64);
+        }
+        memcpy(masks + y * stride, out, width);
+    }
+}
@@ -0,0 +1,99 @@
+/**********************************************************
+ * Author:  Victor Holt
+ * The MIT License (MIT)
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ **********************************************************/
+
+#ifndef DUNGEON_MAP_GRID_H
+#define DUNGEON_MAP_GRID_H
+#include <typedefs.h>
+#include <vector.h>
+
+// Packed occupancy grid storing a single bit per tile. Rows are padded
+// to 64-bit words so a whole row can be processed with word operations.
+class DungeonMapGrid
+{
+    // Occupancy bits, row-major.
+    Vector<uint64_t> bits;
+    // Width of the grid in tiles.
+    int width = 0;
+    // Height of the grid in tiles.
+    int height = 0;
+    // Number of 64-bit words per row.
+    int words_per_row = 0;
+
+public:
+    // Resizes the grid and clears all bits.
+    void resize(int p_width, int p_height);
+    // Clears all bits.
+    void clear();
+
+    // Returns the number of occupied tiles.
+    int count() const;
+
+    // Returns the number of bytes used by the grid.
+    _FORCE_INLINE_ int get_memory_usage() const { return bits.size() * sizeof(uint64_t); }
+
+    // Checks if the tile coordinates are inside of the grid.
+    _FORCE_INLINE_ bool is_inside(int x, int y) const { return x >= 0 && y >= 0 && x < width && y < height; }
+
+    // Returns whether or not a tile is occupied. Tiles outside of the grid are empty.
+    _FORCE_INLINE_ bool get(int x, int y) const
+    {
+        if (!is_inside(x, y)) {
+            return false;
+        }
+        return (bits.ptr()[y * words_per_row + (x >> 6)] >> (x & 63)) & 1;
+    }
+
+    // Sets whether or not a tile is occupied.
+    _FORCE_INLINE_ void set(int x, int y, bool value)
+    {
+        if (!is_inside(x, y)) {
+            return;
+        }
+        uint64_t& word = bits.ptrw()[y * words_per_row + (x >> 6)];
+        uint64_t mask = (uint64_t)1 << (x & 63);
+        word = value ? (word | mask) : (word & ~mask);
+    }
+
+    // Clears the tiles from start to end (inclusive) of a row.
+    void clear_span(int y, int start, int end);
+
+    // Computes the 8-bit neighbor mask of every tile in a single pass over the
+    // rows. A bit is set when the neighbor is occupied, in the order north
+    // (y + 1), east (x + 1), south (y - 1), west (x - 1), north-east,
+    // north-west, south-east and south-west. Masks are written row-major with
+    // `stride` bytes between rows.
+    void compute_neighbor_masks(uint8_t* masks, int stride) const;
+
+    // Returns the words for a single row.
+    _FORCE_INLINE_ const uint64_t* get_row(int y) const { return bits.ptr() + y * words_per_row; }
+
+    // Returns the width of the grid.
+    _FORCE_INLINE_ int get_width() const { return width; }
+    // Returns the height of the grid.
+    _FORCE_INLINE_ int get_height() const { return height; }
+    // Returns the number of words per row.
+    _FORCE_INLINE_ int get_words_per_row() const { return words_per_row; }
+};
+
+#endif
@@ -0,0 +1,46 @@
+#include "dungeon_map_mesh_arrays.h"
+
+#include <scene/resources/mesh.h>
+
+void DungeonMapMeshArrays::resize(int quad_count)
+{
+    vertices.resize(quad_count * 4);
+    normals.resize(quad_count * 4);
+    uvs.resize(quad_count * 4);
+    indices.resize(quad_count * 6);
+}
+
+void DungeonMapMeshArrays::clear()
+{
+    vertices = PoolVector<Vector3>();
+    normals = PoolVector<Vector3>();
+    uvs = PoolVector<Vector2>();
+    indices = PoolVector<int>();
+}
+
+Array DungeonMapMeshArrays::get_arrays() const
+{
+    Array arrays;
+    arrays.resize(Mesh::ARRAY_MAX);
+    arrays[Mesh::ARRAY_VERTEX] = vertices;
+    arrays[Mesh::ARRAY_NORMAL] = normals;
+    arrays[Mesh::ARRAY_TEX_UV] = uvs;
+    arrays[Mesh::ARRAY_INDEX] = indices;
+    return arrays;
+}
+
+DungeonMapMeshWriter::DungeonMapMeshWriter(DungeonMapMeshArrays& arrays)
+{
+    vertex_write = arrays.vertices.write();
+    normal_write = arrays.normals.write();
+    uv_write = arrays.uvs.write();
+    index_write = arrays.indices.write();
+
+    vertices = vertex_write.ptr();
+    normals = normal_write.ptr();
+    uvs = uv_write.ptr();
+    indices = index_write.ptr();
+
+    quad_count = 0;
+    quad_capacity = arrays.get_quad_count();
+}
@@ -0,0 +1,125 @@
+/**********************************************************
+ * Author:  Victor Holt
+ * The MIT License (MIT)
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ **********************************************************/
+
+#ifndef DUNGEON_MAP_MESH_ARRAYS_H
+#define DUNGEON_MAP_MESH_ARRAYS_H
+#include <typedefs.h>
+#include <pool_vector.h>
+#include <array.h>
+#include <math/math_2d.h>
+#include <math/vector3.h>
+
+// Mesh arrays (vertices, normals, uvs and indices) built from quads. The
+// arrays are sized up front from the number of quads, so nothing is
+// reallocated or deduplicated while the mesh is built.
+struct DungeonMapMeshArrays
+{
+    // Vertex positions (four per quad).
+    PoolVector<Vector3> vertices;
+    // Vertex normals (four per quad).
+    PoolVector<Vector3> normals;
+    // Vertex uvs (four per quad).
+    PoolVector<Vector2> uvs;
+    // Triangle indices (six per quad).
+    PoolVector<int> indices;
+
+    // Resizes the arrays to hold the given number of quads.
+    void resize(int quad_count);
+    // Releases the arrays.
+    void clear();
+    // Returns the number of quads the arrays hold.
+    _FORCE_INLINE_ int get_quad_count() const { return vertices.size() / 4; }
+    // Returns true if there is nothing to commit.
+    _FORCE_INLINE_ bool is_empty() const { return vertices.size() == 0; }
+    // Returns the arrays in the layout expected by ArrayMesh/VisualServer.
+    Array get_arrays() const;
+};
+
+// Writes quads into DungeonMapMeshArrays. The arrays stay locked for as long
+// as the writer is alive.
+class DungeonMapMeshWriter
+{
+    // Locks on the arrays.
+    PoolVector<Vector3>::Write vertex_write;
+    PoolVector<Vector3>::Write normal_write;
+    PoolVector<Vector2>::Write uv_write;
+    PoolVector<int>::Write index_write;
+
+    // Pointers into the locked arrays.
+    Vector3* vertices;
+    Vector3* normals;
+    Vector2* uvs;
+    int* indices;
+
+    // Number of quads written so far.
+    int quad_count;
+    // Number of quads the arrays hold.
+    int quad_capacity;
+
+public:
+    // Adds a quad as the triangles (v0, v1, v2) and (v0, v2, v3), using
+    // the face normal of the first triangle.
+    _FORCE_INLINE_ void add_quad(
+        const Vector3& v0, const Vector3& v1, const Vector3& v2, const Vector3& v3,
+        const Vector2& uv0, const Vector2& uv1, const Vector2& uv2, const Vector2& uv3)
+    {
+        ERR_FAIL_COND(quad_count >= quad_capacity);
+
+        int vertex = quad_count * 4;
+        int* index = indices + quad_count * 6;
+        Vector3 normal = (v0 - v2).cross(v0 - v1).normalized();
+
+        vertices[vertex] = v0;
+        vertices[vertex + 1] = v1;
+        vertices[vertex + 2] = v2;
+        vertices[vertex + 3] = v3;
+
+        normals[vertex] = normal;
+        normals[vertex + 1] = normal;
+        normals[vertex + 2] = normal;
+        normals[vertex + 3] = normal;
+
+        uvs[vertex] = uv0;
+        uvs[vertex + 1] = uv1;
+        uvs[vertex + 2] = uv2;
+        uvs[vertex + 3] = uv3;
+
+        index[0] = vertex;
+        index[1] = vertex + 1;
+        index[2] = vertex + 2;
+        index[3] = vertex;
+        index[4] = vertex + 2;
+        index[5] = vertex + 3;
+
+        quad_count++;
+    }
+
+    // Returns the number of quads written so far.
+    _FORCE_INLINE_ int get_quad_count() const { return quad_count; }
+
+    // Constructor.
+    DungeonMapMeshWriter(DungeonMapMeshArrays& arrays);
+};
+
+#endif
@@ -4,253 +4,307 @@
 #include <scene/resources/surface_tool.h>
 #include <servers/visual_server.h>
 
+#include <string.h>
+
 // Using OpenGL (right-handed coord system) convention where -Z is forward...
 
-void DungeonMapMeshBuilder::add_mesh_tile(DungeonMap* dungeon_map, SurfaceTool* tool, const Vector2& tile_id, int height, bool inverse)
+// Corner of a wall quad. The position is the wall origin plus multiples of
+// the tile length and of the run length, the bottom corners are pushed out
+// by the slant.
+struct WallCorner
 {
-    DungeonMap::Tile* tile = dungeon_map->find_tile(tile_id);
-    if (!tile) {
-        return;
-    }
-    float scale = dungeon_map->get_dungeon_params().floor_size;
-    Vector2 origin = Vector2(tile->aabb.position.x, tile->aabb.position.z);
-    Vector3 position = tile->aabb.position;
-
-    if (height == -99999) {
-        height = tile->height;
+    // Multiples of the tile length (x, z).
+    int8_t tile_x, tile_z;
+    // Multiples of the run length (x, z).
+    int8_t run_x, run_z;
+    // 1 for the top corners, 0 for the bottom ones.
+    int8_t top;
+    // Direction the bottom corner is pushed by the slant (x, z).
+    int8_t slant_x, slant_z;
+};
+
+// Wall quad corners for each side (north, east, south, west), wound to face out of the tile.
+static const WallCorner wall_corners[4][4] = {
+    // North
+    { { 0, -1, 0, 0, 0, -1, -1 }, { 0, -1, 1, 0, 0, 1, -1 }, { 0, -1, 1, 0, 1, 0, 0 }, { 0, -1, 0, 0, 1, 0, 0 } },
+    // East
+    { { 1, 0, 0, 0, 0, 1, 1 }, { 1, 0, 0, 0, 1, 0, 0 }, { 1, 0, 0, -1, 1, 0, 0 }, { 1, 0, 0, -1, 0, 1, -1 } },
+    // South
+    { { 0, 0, 0, 0, 0, -1, 1 }, { 0, 0, 0, 0, 1, 0, 0 }, { 0, 0, 1, 0, 1, 0, 0 }, { 0, 0, 1, 0, 0, 1, 1 } },
+    // West
+    { { 0, 0, 0, 0, 0, -1, 1 }, { 0, 0, 0, -1, 0, -1, -1 }, { 0, 0, 0, -1, 1, 0, 0 }, { 0, 0, 0, 0, 1, 0, 0 } }
+};
+
+// Exposed sides for each combination of the north, east, south and west
+// neighbor bits (marching squares cases).
+struct WallCase
+{
+    // Number of exposed sides.
+    uint8_t count;
+    // Exposed sides (Neighbor values).
+    uint8_t sides[4];
+};
+
+static const WallCase wall_cases[16] = {
+    { 4, { 0, 1, 2, 3 } }, { 3, { 1, 2, 3, 0 } }, { 3, { 0, 2, 3, 0 } }, { 2, { 2, 3, 0, 0 } },
+    { 3, { 0, 1, 3, 0 } }, { 2, { 1, 3, 0, 0 } }, { 2, { 0, 3, 0, 0 } }, { 1, { 3, 0, 0, 0 } },
+    { 3, { 0, 1, 2, 0 } }, { 2, { 1, 2, 0, 0 } }, { 2, { 0, 2, 0, 0 } }, { 1, { 2, 0, 0, 0 } },
+    { 2, { 0, 1, 0, 0 } }, { 1, { 1, 0, 0, 0 } }, { 1, { 0, 0, 0, 0 } }, { 0, { 0, 0, 0, 0 } }
+};
+
+// Projects a vertex to a uv coordinate (one unit per world unit).
+template <DungeonMapMeshBuilder::UVType UV>
+static _FORCE_INLINE_ Vector2 _project_uv(const Vector3& vertex);
+
+template <>
+_FORCE_INLINE_ Vector2 _project_uv<DungeonMapMeshBuilder::UV_XY>(const Vector3& vertex) { return Vector2(vertex.x, vertex.y); }
+
+template <>
+_FORCE_INLINE_ Vector2 _project_uv<DungeonMapMeshBuilder::UV_ZY>(const Vector3& vertex) { return Vector2(vertex.z, vertex.y); }
+
+// Wall quad kernel, specialized on the winding and the uv projection.
+template <bool INVERSE, DungeonMapMeshBuilder::UVType UV>
+static void _add_wall(DungeonMapMeshWriter* writer, const WallCorner* corners, const Vector2& origin, float length, float run, float height, float slant)
+{
+    Vector3 v[4];
+    for (int i = 0; i < 4; i++) {
+        const WallCorner& c = corners[i];
+        float bottom_slant = slant * (1 - c.top);
+        v[i] = Vector3(
+            origin.x + c.tile_x * length + c.run_x * run + c.slant_x * bottom_slant,
+            c.top * height,
+            origin.y + c.tile_z * length + c.run_z * run + c.slant_z * bottom_slant
+        );
     }
 
-    if (!inverse) {
-        // Triangle 1
-        tool->add_uv(get_uv(UVType::UV_XZ, Vector3(position.x, height, position.y), scale));
-        tool->add_vertex(Vector3(origin.x, height, origin.y));
-
-        tool->add_uv(get_uv(UVType::UV_XZ, Vector3(position.x, height, position.y + scale), scale));
-        tool->add_vertex(Vector3(origin.x, height, origin.y - scale));
-
-        tool->add_uv(get_uv(UVType::UV_XZ, Vector3(position.x + scale, height, position.y), scale));
-        tool->add_vertex(Vector3(origin.x + scale, height, origin.y));
-
-        // Triangle 2
-        tool->add_uv(get_uv(UVType::UV_XZ, Vector3(position.x + scale, height, position.y), scale));
-        tool->add_vertex(Vector3(origin.x + scale, height, origin.y));
-
-        tool->add_uv(get_uv(UVType::UV_XZ, Vector3(position.x, height, position.y + scale), scale));
-        tool->add_vertex(Vector3(origin.x, height, origin.y - scale));
-
-        tool->add_uv(get_uv(UVType::UV_XZ, Vector3(position.x + scale, height, position.y + scale), scale));
-        tool->add_vertex(Vector3(origin.x + scale, height, origin.y - scale));
+    // Reversing the vertex order flips the winding (and the normal).
+    if (INVERSE) {
+        writer->add_quad(v[0], v[3], v[2], v[1], _project_uv<UV>(v[0]), _project_uv<UV>(v[3]), _project_uv<UV>(v[2]), _project_uv<UV>(v[1]));
     } else {
-        // Triangle 1
-        tool->add_uv(get_uv(UVType::UV_XZ, Vector3(position.x, height, position.y), scale));
-        tool->add_vertex(Vector3(origin.x, height, origin.y));
-
-        tool->add_uv(get_uv(UVType::UV_XZ, Vector3(position.x + scale, height, position.y), scale));
-        tool->add_vertex(Vector3(origin.x + scale, height, origin.y));
-
-        tool->add_uv(get_uv(UVType::UV_XZ, Vector3(position.x, height, position.y + scale), scale));
-        tool->add_vertex(Vector3(origin.x, height, origin.y - scale));
+        writer->add_quad(v[0], v[1], v[2], v[3], _project_uv<UV>(v[0]), _project_uv<UV>(v[1]), _project_uv<UV>(v[2]), _project_uv<UV>(v[3]));
+    }
+}
 
-        // Triangle 2
-        tool->add_uv(get_uv(UVType::UV_XZ, Vector3(position.x + scale, height, position.y), scale));
-        tool->add_vertex(Vector3(origin.x + scale, height, origin.y));
+// Wall kernel type.
+typedef void (*WallKernel)(DungeonMapMeshWriter*, const WallCorner*, const Vector2&, float, float, float, float);
 
-        tool->add_uv(get_uv(UVType::UV_XZ, Vector3(position.x + scale, height, position.y + scale), scale));
-        tool->add_vertex(Vector3(origin.x + scale, height, origin.y - scale));
+// Wall kernels by winding (outward, inverse) and side (north/south walls face along z, east/west along x).
+static const WallKernel wall_kernels[2][4] = {
+    { _add_wall<false, DungeonMapMeshBuilder::UV_XY>, _add_wall<false, DungeonMapMeshBuilder::UV_ZY>, _add_wall<false, DungeonMapMeshBuilder::UV_XY>, _add_wall<false, DungeonMapMeshBuilder::UV_ZY> },
+    { _add_wall<true, DungeonMapMeshBuilder::UV_XY>, _add_wall<true, DungeonMapMeshBuilder::UV_ZY>, _add_wall<true, DungeonMapMeshBuilder::UV_XY>, _add_wall<true, DungeonMapMeshBuilder::UV_ZY> }
+};
 
-        tool->add_uv(get_uv(UVType::UV_XZ, Vector3(position.x, height, position.y + scale), scale));
-        tool->add_vertex(Vector3(origin.x, height, origin.y - scale));
+void DungeonMapMeshBuilder::add_mesh_tile(const DungeonMap::Level* level, DungeonMapMeshWriter* writer, int tile_index, int height, bool inverse)
+{
+    if (tile_index < 0 || tile_index >= level->get_tile_count()) {
+        return;
     }
+
+    TileRect rect;
+    rect.x = tile_index % level->tile_width;
+    rect.y = tile_index / level->tile_width;
+    rect.width = 1;
+    rect.height = 1;
+    add_mesh_rect(level, writer, rect, height, inverse);
 }
 
-void DungeonMapMeshBuilder::add_mesh_tile(DungeonMap* dungeon_map, SurfaceTool* tool, const Vector2& tile_id, bool inverse)
+void DungeonMapMeshBuilder::add_mesh_tile(const DungeonMap::Level* level, DungeonMapMeshWriter* writer, int tile_index, bool inverse)
 {
-    add_mesh_tile(dungeon_map, tool, tile_id, -99999, inverse);
+    add_mesh_tile(level, writer, tile_index, -99999, inverse);
 }
 
-void DungeonMapMeshBuilder::add_mesh_tile_edge(DungeonMap* dungeon_map, SurfaceTool* tool, const Vector2& tile_id, int height, bool inverse)
+void DungeonMapMeshBuilder::merge_tiles(const DungeonMap::Level* level, int x, int y, int width, int height, Vector<TileRect>& rects)
 {
-    DungeonMap::Tile* tile = dungeon_map->find_tile(tile_id);
-    if (!tile || tile->type == DungeonMap::TileType::EMPTY) {
+    // Clip the area to the map.
+    width = MIN(x + width, level->tile_width) - x;
+    height = MIN(y + height, level->tile_height) - y;
+    if (width <= 0 || height <= 0) {
         return;
     }
 
-    Vector2 origin = Vector2(tile->aabb.position.x, tile->aabb.position.z);
-    Vector3 position = tile->aabb.position;
-    if (height == -99999) {
-        height = tile->height;
-    }
-    float length = dungeon_map->get_dungeon_params().floor_size;
-    float edge_slant = 0.0f;
-
-    if (!tile->has_north_tile || ((DungeonMap::Tile*)tile->neighbors[(uint8_t)DungeonMap::NEIGHBOR_NORTH])->type == DungeonMap::EMPTY) {
-        Vector3 v01 = Vector3(origin.x - edge_slant, 0.0f, origin.y - length - edge_slant);
-        Vector3 v02 = Vector3(origin.x + length, height, origin.y - length);
-        Vector3 v03 = Vector3(origin.x, height, origin.y - length);
-
-        Vector3 v11 = Vector3(origin.x - edge_slant, 0.0f, origin.y - length - edge_slant);
-        Vector3 v12 = Vector3(origin.x + length + edge_slant, 0.0f, origin.y - length - edge_slant);
-        Vector3 v13 = Vector3(origin.x + length, height, origin.y - length);
-
-        // Check if we need to inverse the mesh.
-        if (inverse) {
-            Vector3 tmp = v02;
-            v02 = v03;
-            v03 = tmp;
-
-            tmp = v12;
-            v12 = v13;
-            v13 = tmp;
+    Vector<uint8_t> merged;
+    merged.resize(width * height);
+    memset(merged.ptrw(), 0, width * height);
+    uint8_t* used = merged.ptrw();
+
+    const uint8_t* types = level->tile_types.ptr();
+    const int16_t* heights = level->tile_heights.ptr();
+
+    for (int ly = 0; ly < height; ly++) {
+        for (int lx = 0; lx < width; lx++) {
+            int index = (y + ly) * level->tile_width + x + lx;
+            if (used[ly * width + lx] || types[index] == DungeonMap::TileType::EMPTY) {
+                continue;
+            }
+
+            // Grow along the row while the tiles match.
+            int rect_width = 1;
+            while (lx + rect_width < width && !used[ly * width + lx + rect_width]
+                    && types[index + rect_width] == types[index] && heights[index + rect_width] == heights[index]) {
+                rect_width++;
+            }
+
+            // Grow across rows while the whole span matches.
+            int rect_height = 1;
+            while (ly + rect_height < height) {
+                int row = index + rect_height * level->tile_width;
+                int i = 0;
+                for (; i < rect_width; i++) {
+                    if (used[(ly + rect_height) * width + lx + i] || types[row + i] != types[index] || heights[row + i] != heights[index]) {
+                        break;
+                    }
+                }
+                if (i < rect_width) {
+                    break;
+                }
+                rect_height++;
+            }
+
+            for (int ry = 0; ry < rect_height; ry++) {
+                memset(used + (ly + ry) * width + lx, 1, rect_width);
+            }
+
+            TileRect rect;
+            rect.x = x + lx;
+            rect.y = y + ly;
+            rect.width = rect_width;
+            rect.height = rect_height;
+            rects.push_back(rect);
         }
-
-        // Triangle #1
-        tool->add_uv(get_uv(UVType::UV_XY, v01));
-        tool->add_vertex(v01);
-
-        tool->add_uv(get_uv(UVType::UV_XY, v02));
-        tool->add_vertex(v02);
-
-        tool->add_uv(get_uv(UVType::UV_XY, v03));
-        tool->add_vertex(v03);
-
-        // Triangle #2
-        tool->add_uv(get_uv(UVType::UV_XY, v11));
-        tool->add_vertex(v11);
-
-        tool->add_uv(get_uv(UVType::UV_XY, v12));
-        tool->add_vertex(v12);
-
-        tool->add_uv(get_uv(UVType::UV_XY, v13));
-        tool->add_vertex(v13);
     }
+}
 
-    if (!tile->has_east_tile || ((DungeonMap::Tile*)tile->neighbors[(uint8_t)DungeonMap::NEIGHBOR_EAST])->type == DungeonMap::EMPTY) {
-        Vector3 v01 = Vector3(origin.x + length + edge_slant, 0.0f, origin.y + edge_slant);
-        Vector3 v02 = Vector3(origin.x + length, height, origin.y);
-        Vector3 v03 = Vector3(origin.x + length, height, origin.y - length);
-
-        Vector3 v11 = Vector3(origin.x + length + edge_slant, 0.0f, origin.y + edge_slant);
-        Vector3 v12 = Vector3(origin.x + length, height, origin.y - length);
-        Vector3 v13 = Vector3(origin.x + length + edge_slant, 0.0f, origin.y - length - edge_slant);
-
-        // Check if we need to inverse the mesh.
-        if (inverse) {
-            Vector3 tmp = v02;
-            v02 = v03;
-            v03 = tmp;
-
-            tmp = v12;
-            v12 = v13;
-            v13 = tmp;
-        }
-
-        // Triangle #1
-        tool->add_uv(get_uv(UVType::UV_ZY, v01));
-        tool->add_vertex(v01);
-
-        tool->add_uv(get_uv(UVType::UV_ZY, v02));
-        tool->add_vertex(v02);
-
-        tool->add_uv(get_uv(UVType::UV_ZY, v03));
-        tool->add_vertex(v03);
-
-        // Triangle #2
-        tool->add_uv(get_uv(UVType::UV_ZY, v11));
-        tool->add_vertex(v11);
-
-        tool->add_uv(get_uv(UVType::UV_ZY, v12));
-        tool->add_vertex(v12);
-
-        tool->add_uv(get_uv(UVType::UV_ZY, v13));
-        tool->add_vertex(v13);
+void DungeonMapMeshBuilder::add_mesh_rect(const DungeonMap::Level* level, DungeonMapMeshWriter* writer, const TileRect& rect, int height, bool inverse)
+{
+    float scale = level->tile_size;
+    if (height == -99999) {
+        height = level->get_tile_height(level->get_tile_index(rect.x, rect.y));
     }
 
-    if (!tile->has_south_tile || ((DungeonMap::Tile*)tile->neighbors[(uint8_t)DungeonMap::NEIGHBOR_SOUTH])->type == DungeonMap::EMPTY) {
-        Vector3 v01 = Vector3(origin.x - edge_slant, 0.0f, origin.y + edge_slant);
-        Vector3 v02 = Vector3(origin.x, height, origin.y);
-        Vector3 v03 = Vector3(origin.x + length, height, origin.y);
+    // Corners of the rectangle (tile y grows north, towards -z).
+    float x0 = rect.x * scale;
+    float x1 = (rect.x + rect.width) * scale;
+    float z0 = rect.y * scale * -1.0f;
+    float z1 = (rect.y + rect.height) * scale * -1.0f;
 
-        Vector3 v11 = Vector3(origin.x - edge_slant, 0.0f, origin.y + edge_slant);
-        Vector3 v12 = Vector3(origin.x + length, height, origin.y);
-        Vector3 v13 = Vector3(origin.x + length + edge_slant, 0.0f, origin.y + edge_slant);
+    Vector3 v0 = Vector3(x0, height, z1);
+    Vector3 v1 = Vector3(x1, height, z1);
+    Vector3 v2 = Vector3(x1, height, z0);
+    Vector3 v3 = Vector3(x0, height, z0);
 
-        // Check if we need to inverse the mesh.
-        if (inverse) {
-            Vector3 tmp = v02;
-            v02 = v03;
-            v03 = tmp;
+    // World space uvs (one unit per tile) so merged quads tile the same way as single tiles.
+    Vector2 uv0 = get_uv(UVType::UV_XZ, Vector3(v0.x, height, -v0.z), scale);
+    Vector2 uv1 = get_uv(UVType::UV_XZ, Vector3(v1.x, height, -v1.z), scale);
+    Vector2 uv2 = get_uv(UVType::UV_XZ, Vector3(v2.x, height, -v2.z), scale);
+    Vector2 uv3 = get_uv(UVType::UV_XZ, Vector3(v3.x, height, -v3.z), scale);
 
-            tmp = v12;
-            v12 = v13;
-            v13 = tmp;
-        }
-
-        // Triangle #1
-        tool->add_uv(get_uv(UVType::UV_XY, v01));
-        tool->add_vertex(v01);
-
-        tool->add_uv(get_uv(UVType::UV_XY, v02));
-        tool->add_vertex(v02);
-
-        tool->add_uv(get_uv(UVType::UV_XY, v03));
-        tool->add_vertex(v03);
+    if (!inverse) {
+        writer->add_quad(v0, v1, v2, v3, uv0, uv1, uv2, uv3);
+    } else {
+        writer->add_quad(v0, v3, v2, v1, uv0, uv3, uv2, uv1);
+    }
+}
 
-        // Triangle #2
-        tool->add_uv(get_uv(UVType::UV_XY, v11));
-        tool->add_vertex(v11);
+void DungeonMapMeshBuilder::add_mesh_tile_edge(const DungeonMap::Level* level, DungeonMapMeshWriter* writer, int tile_index, int height, bool inverse, float slant)
+{
+    if (tile_index < 0 || tile_index >= level->get_tile_count() || level->get_tile_type(tile_index) == DungeonMap::TileType::EMPTY) {
+        return;
+    }
 
-        tool->add_uv(get_uv(UVType::UV_XY, v12));
-        tool->add_vertex(v12);
+    Vector2 origin = level->get_tile_id(tile_index);
+    if (height == -99999) {
+        height = level->get_tile_height(tile_index);
+    }
+    float length = level->tile_size;
 
-        tool->add_uv(get_uv(UVType::UV_XY, v13));
-        tool->add_vertex(v13);
+    const WallCase& wall_case = wall_cases[level->get_tile_neighbors(tile_index) & 0x0f];
+    const WallKernel* kernels = wall_kernels[inverse ? 1 : 0];
+    for (int i = 0; i < wall_case.count; i++) {
+        int side = wall_case.sides[i];
+        kernels[side](writer, wall_corners[side], origin, length, length, height, slant);
     }
+}
 
-    if (!tile->has_west_tile || ((DungeonMap::Tile*)tile->neighbors[(uint8_t)DungeonMap::NEIGHBOR_WEST])->type == DungeonMap::EMPTY) {
-        Vector3 v01 = Vector3(origin.x - edge_slant, 0.0f, origin.y + edge_slant);
-        Vector3 v02 = Vector3(origin.x, height, origin.y - length);
-        Vector3 v03 = Vector3(origin.x, height, origin.y);
+void DungeonMapMeshBuilder::add_mesh_tile_edge(const DungeonMap::Level* level, DungeonMapMeshWriter* writer, int tile_index, bool inverse, float slant)
+{
+    add_mesh_tile_edge(level, writer, tile_index, -99999, inverse, slant);
+}
 
-        Vector3 v11 = Vector3(origin.x - edge_slant, 0.0f, origin.y + edge_slant);
-        Vector3 v12 = Vector3(origin.x - edge_slant, 0.0f, origin.y - length - edge_slant);
-        Vector3 v13 = Vector3(origin.x, height, origin.y - length);
+// Checks if a tile's side is exposed (non-empty tile without a neighbor on that side).
+static _FORCE_INLINE_ bool _is_edge_exposed(const DungeonMap::Level* level, int index, DungeonMap::Neighbor side)
+{
+    return level->get_tile_type(index) != DungeonMap::TileType::EMPTY && !level->has_tile_neighbor(index, side);
+}
 
-        // Check if we need to inverse the mesh.
-        if (inverse) {
-            Vector3 tmp = v02;
-            v02 = v03;
-            v03 = tmp;
+void DungeonMapMeshBuilder::merge_tile_edges(const DungeonMap::Level* level, int x, int y, int width, int height, Vector<TileEdge>& edges)
+{
+    // Clip the area to the map.
+    width = MIN(x + width, level->tile_width) - x;
+    height = MIN(y + height, level->tile_height) - y;
+    if (width <= 0 || height <= 0) {
+        return;
+    }
 
-            tmp = v12;
-            v12 = v13;
-            v13 = tmp;
+    // North and south sides run along the rows, east and west sides along the columns.
+    static const DungeonMap::Neighbor sides[4] = {
+        DungeonMap::NEIGHBOR_NORTH, DungeonMap::NEIGHBOR_SOUTH, DungeonMap::NEIGHBOR_EAST, DungeonMap::NEIGHBOR_WEST
+    };
+    for (int s = 0; s < 4; s++) {
+        DungeonMap::Neighbor side = sides[s];
+        bool rows = side == DungeonMap::NEIGHBOR_NORTH || side == DungeonMap::NEIGHBOR_SOUTH;
+        int lines = rows ? height : width;
+        int line_length = rows ? width : height;
+        int step = rows ? 1 : level->tile_width;
+
+        for (int line = 0; line < lines; line++) {
+            int first = rows ? level->get_tile_index(x, y + line) : level->get_tile_index(x + line, y);
+            int i = 0;
+            while (i < line_length) {
+                int index = first + i * step;
+                if (!_is_edge_exposed(level, index, side)) {
+                    i++;
+                    continue;
+                }
+
+                // Extend the run while the sides stay exposed at the same height.
+                int length = 1;
+                while (i + length < line_length) {
+                    int next = index + length * step;
+                    if (!_is_edge_exposed(level, next, side) || level->get_tile_height(next) != level->get_tile_height(index)) {
+                        break;
+                    }
+                    length++;
+                }
+
+                TileEdge edge;
+                edge.x = rows ? x + i : x + line;
+                edge.y = rows ? y + line : y + i;
+                edge.length = length;
+                edge.side = side;
+                edges.push_back(edge);
+                i += length;
+            }
         }
+    }
+}
 
-        // Triangle #1
-        tool->add_uv(get_uv(UVType::UV_ZY, v01));
-        tool->add_vertex(v01);
-
-        tool->add_uv(get_uv(UVType::UV_ZY, v02));
-        tool->add_vertex(v02);
-
-        tool->add_uv(get_uv(UVType::UV_ZY, v03));
-        tool->add_vertex(v03);
-
-        // Triangle #2
-        tool->add_uv(get_uv(UVType::UV_ZY, v11));
-        tool->add_vertex(v11);
-
-        tool->add_uv(get_uv(UVType::UV_ZY, v12));
-        tool->add_vertex(v12);
-
-        tool->add_uv(get_uv(UVType::UV_ZY, v13));
-        tool->add_vertex(v13);
+void DungeonMapMeshBuilder::add_mesh_edge(const DungeonMap::Level* level, DungeonMapMeshWriter* writer, const TileEdge& edge, int height, bool inverse, float slant)
+{
+    float length = level->tile_size;
+    Vector2 origin = Vector2(edge.x * length, edge.y * length * -1.0f);
+    if (height == -99999) {
+        height = level->get_tile_height(level->get_tile_index(edge.x, edge.y));
     }
+
+    wall_kernels[inverse ? 1 : 0][edge.side](writer, wall_corners[edge.side], origin, length, edge.length * length, height, slant);
 }
 
-void DungeonMapMeshBuilder::add_mesh_tile_edge(DungeonMap* dungeon_map, SurfaceTool* tool, const Vector2& tile_id, bool inverse)
+int DungeonMapMeshBuilder::get_mesh_tile_edge_count(const DungeonMap::Level* level, int tile_index)
 {
-    add_mesh_tile_edge(dungeon_map, tool, tile_id, -99999, inverse);
+    if (tile_index < 0 || tile_index >= level->get_tile_count() || level->get_tile_type(tile_index) == DungeonMap::TileType::EMPTY) {
+        return 0;
+    }
+    return wall_cases[level->get_tile_neighbors(tile_index) & 0x0f].count;
 }
 
 RID DungeonMapMeshBuilder::create_mesh_from_aabb(const AABB& aabb)
@@ -29,7 +29,8 @@
 #include <math/aabb.h>
 #include <scene/resources/surface_tool.h>
 
-class DungeonMap;
+#include "dungeon_map.h"
+#include "dungeon_map_mesh_arrays.h"
 
 class DungeonMapMeshBuilder
 {
@@ -43,15 +44,47 @@ public:
         UV_ZY
     };
 
-    // Creates a tile mesh based on the given tile id.
-    static void add_mesh_tile(DungeonMap* dungeon_map, SurfaceTool* tool, const Vector2& tile_id, int height, bool inverse = false);
-    // Creates a tile mesh based on the given tile id.
-    static void add_mesh_tile(DungeonMap* dungeon_map, SurfaceTool* tool, const Vector2& tile_id, bool inverse = false);
+    // Rectangle of tiles (in tile coordinates) sharing the same type and height.
+    struct TileRect
+    {
+        int x;
+        int y;
+        int width;
+        int height;
+    };
+
+    // Straight run of exposed tile sides. North and south runs go east
+    // from the first tile, east and west runs go north.
+    struct TileEdge
+    {
+        int x;
+        int y;
+        int length;
+        DungeonMap::Neighbor side;
+    };
+
+    // Creates a tile mesh based on the given tile index.
+    static void add_mesh_tile(const DungeonMap::Level* level, DungeonMapMeshWriter* writer, int tile_index, int height, bool inverse = false);
+    // Creates a tile mesh based on the given tile index.
+    static void add_mesh_tile(const DungeonMap::Level* level, DungeonMapMeshWriter* writer, int tile_index, bool inverse = false);
+
+    // Merges the non-empty tiles of an area into as few rectangles as possible (greedy meshing).
+    static void merge_tiles(const DungeonMap::Level* level, int x, int y, int width, int height, Vector<TileRect>& rects);
+    // Creates a single quad covering a rectangle of tiles (uses the height of its first tile when none is given).
+    static void add_mesh_rect(const DungeonMap::Level* level, DungeonMapMeshWriter* writer, const TileRect& rect, int height, bool inverse = false);
+
+    // Creates a tile mesh based on the given tile index.
+    static void add_mesh_tile_edge(const DungeonMap::Level* level, DungeonMapMeshWriter* writer, int tile_index, int height, bool inverse = false, float slant = 0.0f);
+    // Creates a tile mesh based on the given tile index.
+    static void add_mesh_tile_edge(const DungeonMap::Level* level, DungeonMapMeshWriter* writer, int tile_index, bool inverse = false, float slant = 0.0f);
+
+    // Merges the exposed sides of the tiles in an area into straight runs along rows and columns.
+    static void merge_tile_edges(const DungeonMap::Level* level, int x, int y, int width, int height, Vector<TileEdge>& edges);
+    // Creates a single wall quad covering a run of tile sides (uses the height of its first tile when none is given).
+    static void add_mesh_edge(const DungeonMap::Level* level, DungeonMapMeshWriter* writer, const TileEdge& edge, int height, bool inverse = false, float slant = 0.0f);
 
-    // Creates a tile mesh based on the given tile id.
-    static void add_mesh_tile_edge(DungeonMap* dungeon_map, SurfaceTool* tool, const Vector2& tile_id, int height, bool inverse = false);
-    // Creates a tile mesh based on the given tile id.
-    static void add_mesh_tile_edge(DungeonMap* dungeon_map, SurfaceTool* tool, const Vector2& tile_id, bool inverse = false);
+    // Returns the number of edge quads add_mesh_tile_edge creates for the tile.
+    static int get_mesh_tile_edge_count(const DungeonMap::Level* level, int tile_index);
 
     // Creates a mesh from a given aabb.
     static RID create_mesh_from_aabb(const AABB& aabb);
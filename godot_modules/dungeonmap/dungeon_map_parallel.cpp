@@ -0,0 +1,65 @@
+#include "dungeon_map_parallel.h"
+
+#include <os/os.h>
+#include <os/thread.h>
+#include <safe_refcount.h>
+#include <vector.h>
+
+// Work shared between the threads of a single run.
+struct DungeonMapParallelWork
+{
+    // Job to run.
+    DungeonMapParallel::Job job;
+    // Job userdata.
+    void* userdata;
+    // Number of jobs.
+    uint32_t count;
+    // Number of jobs handed out so far.
+    uint32_t next;
+};
+
+// Takes jobs until none are left.
+static void _parallel_worker(void* p_userdata)
+{
+    DungeonMapParallelWork* work = (DungeonMapParallelWork*)p_userdata;
+    while (true) {
+        uint32_t index = atomic_increment(&work->next) - 1;
+        if (index >= work->count) {
+            break;
+        }
+        work->job(work->userdata, (int)index);
+    }
+}
+
+void DungeonMapParallel::run(int count, Job job, void* userdata, int thread_count)
+{
+    if (count <= 0) {
+        return;
+    }
+
+    if (thread_count <= 0) {
+        thread_count = OS::get_singleton()->get_processor_count();
+    }
+    thread_count = MIN(thread_count, count);
+
+    DungeonMapParallelWork work;
+    work.job = job;
+    work.userdata = userdata;
+    work.count = count;
+    work.next = 0;
+
+    // The calling thread is one of the workers.
+    Vector<Thread*> threads;
+    for (int i = 1; i < thread_count; i++) {
+        Thread* thread = Thread::create(_parallel_worker, &work);
+        if (thread) {
+            threads.push_back(thread);
+        }
+    }
+    _parallel_worker(&work);
+
+    for (int i = 0; i < threads.size(); i++) {
+        Thread::wait_to_finish(threads[i]);
+        memdelete(threads[i]);
+    }
+}
@@ -0,0 +1,301 @@
+#include "dungeon_map_path_finder.h"
+
+#include <string.h>
+
+// Cost of a straight and of a diagonal step.
+#define PATH_COST_STRAIGHT 10
+#define PATH_COST_DIAGONAL 14
+
+// Returns -1, 0 or 1 (SGN treats 0 as positive).
+static _FORCE_INLINE_ int _sign(int value)
+{
+    return (value > 0) - (value < 0);
+}
+
+DungeonMapPathFinder::Scratch* DungeonMapPathFinder::_acquire(int tile_count)
+{
+    Scratch* scratch = NULL;
+    mutex->lock();
+    if (free_scratch.size() > 0) {
+        scratch = free_scratch[free_scratch.size() - 1];
+        free_scratch.resize(free_scratch.size() - 1);
+    }
+    mutex->unlock();
+
+    if (!scratch) {
+        scratch = memnew(Scratch);
+    }
+
+    // Resize for the grid, the stamps start over with new buffers.
+    if (scratch->cost.size() != tile_count) {
+        scratch->cost.resize(tile_count);
+        scratch->parent.resize(tile_count);
+        scratch->opened.resize(tile_count);
+        scratch->closed.resize(tile_count);
+        scratch->stamp = 0;
+    }
+
+    scratch->stamp++;
+    if (scratch->stamp == 0) {
+        scratch->stamp = 1;
+    }
+    if (scratch->stamp == 1 && tile_count > 0) {
+        memset(scratch->opened.ptrw(), 0, tile_count * sizeof(uint32_t));
+        memset(scratch->closed.ptrw(), 0, tile_count * sizeof(uint32_t));
+    }
+    scratch->open.clear();
+    return scratch;
+}
+
+void DungeonMapPathFinder::_release(Scratch* scratch)
+{
+    mutex->lock();
+    free_scratch.push_back(scratch);
+    mutex->unlock();
+}
+
+uint32_t DungeonMapPathFinder::_heuristic(const Grid& grid, int from, int to, bool allow_diagonal)
+{
+    int dx = ABS(from % grid.width - to % grid.width);
+    int dy = ABS(from / grid.width - to / grid.width);
+    if (!allow_diagonal) {
+        return (dx + dy) * PATH_COST_STRAIGHT;
+    }
+    // Octile distance.
+    return (dx + dy) * PATH_COST_STRAIGHT + MIN(dx, dy) * (PATH_COST_DIAGONAL - 2 * PATH_COST_STRAIGHT);
+}
+
+void DungeonMapPathFinder::_visit(Scratch* scratch, const Grid& grid, int index, int parent, uint32_t cost, int goal, bool allow_diagonal)
+{
+    uint32_t* costs = scratch->cost.ptrw();
+    if (scratch->closed[index] == scratch->stamp) {
+        return;
+    }
+    if (scratch->opened[index] == scratch->stamp && costs[index] <= cost) {
+        return;
+    }
+
+    // Stale entries stay in the heap and are skipped once the tile is closed.
+    costs[index] = cost;
+    scratch->parent.ptrw()[index] = parent;
+    scratch->opened.ptrw()[index] = scratch->stamp;
+    scratch->open.push(cost + _heuristic(grid, index, goal, allow_diagonal), index);
+}
+
+int DungeonMapPathFinder::_jump(const Grid& grid, int x, int y, int dx, int dy, int goal)
+{
+    while (true) {
+        if (!grid.is_walkable(x, y)) {
+            return -1;
+        }
+        int index = y * grid.width + x;
+        if (index == goal) {
+            return index;
+        }
+
+        if (dx != 0 && dy != 0) {
+            // Diagonal moves stop where a straight jump finds something.
+            if (_jump(grid, x + dx, y, dx, 0, goal) >= 0 || _jump(grid, x, y + dy, 0, dy, goal) >= 0) {
+                return index;
+            }
+            // Never cut corners.
+            if (!grid.is_walkable(x + dx, y) || !grid.is_walkable(x, y + dy)) {
+                return -1;
+            }
+        } else if (dx != 0) {
+            // Forced neighbor: a side opens up that was blocked behind us.
+            if ((grid.is_walkable(x, y + 1) && !grid.is_walkable(x - dx, y + 1)) ||
+                    (grid.is_walkable(x, y - 1) && !grid.is_walkable(x - dx, y - 1))) {
+                return index;
+            }
+        } else {
+            if ((grid.is_walkable(x + 1, y) && !grid.is_walkable(x + 1, y - dy)) ||
+                    (grid.is_walkable(x - 1, y) && !grid.is_walkable(x - 1, y - dy))) {
+                return index;
+            }
+        }
+
+        x += dx;
+        y += dy;
+    }
+}
+
+bool DungeonMapPathFinder::_search_4(Scratch* scratch, const Grid& grid, int from, int to)
+{
+    static const int directions[4][2] = { { 0, 1 }, { 1, 0 }, { 0, -1 }, { -1, 0 } };
+
+    _visit(scratch, grid, from, -1, 0, to, false);
+    while (true) {
+        int index = scratch->open.pop();
+        if (index < 0) {
+            return false;
+        }
+        if (scratch->closed[index] == scratch->stamp) {
+            continue;
+        }
+        scratch->closed.ptrw()[index] = scratch->stamp;
+        if (index == to) {
+            return true;
+        }
+
+        int x = index % grid.width;
+        int y = index / grid.width;
+        uint32_t cost = scratch->cost[index] + PATH_COST_STRAIGHT;
+        for (int i = 0; i < 4; i++) {
+            int nx = x + directions[i][0];
+            int ny = y + directions[i][1];
+            if (grid.is_walkable(nx, ny)) {
+                _visit(scratch, grid, ny * grid.width + nx, index, cost, to, false);
+            }
+        }
+    }
+}
+
+bool DungeonMapPathFinder::_search_8(Scratch* scratch, const Grid& grid, int from, int to)
+{
+    _visit(scratch, grid, from, -1, 0, to, true);
+    while (true) {
+        int index = scratch->open.pop();
+        if (index < 0) {
+            return false;
+        }
+        if (scratch->closed[index] == scratch->stamp) {
+            continue;
+        }
+        scratch->closed.ptrw()[index] = scratch->stamp;
+        if (index == to) {
+            return true;
+        }
+
+        int x = index % grid.width;
+        int y = index / grid.width;
+
+        // Directions worth searching from this tile.
+        int directions[8][2];
+        int count = 0;
+        int parent = scratch->parent[index];
+        if (parent < 0) {
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    if ((dx == 0 && dy == 0) || !grid.is_walkable(x + dx, y + dy)) {
+                        continue;
+                    }
+                    if (dx != 0 && dy != 0 && (!grid.is_walkable(x + dx, y) || !grid.is_walkable(x, y + dy))) {
+                        continue;
+                    }
+                    directions[count][0] = dx;
+                    directions[count][1] = dy;
+                    count++;
+                }
+            }
+        } else {
+            int dx = _sign(x - parent % grid.width);
+            int dy = _sign(y - parent / grid.width);
+            if (dx != 0 && dy != 0) {
+                bool horizontal = grid.is_walkable(x + dx, y);
+                bool vertical = grid.is_walkable(x, y + dy);
+                if (vertical) {
+                    directions[count][0] = 0;
+                    directions[count][1] = dy;
+                    count++;
+                }
+                if (horizontal) {
+                    directions[count][0] = dx;
+                    directions[count][1] = 0;
+                    count++;
+                }
+                if (horizontal && vertical) {
+                    directions[count][0] = dx;
+                    directions[count][1] = dy;
+                    count++;
+                }
+            } else {
+                // Straight moves continue ahead and turn towards the open sides.
+                int side_x = dy;
+                int side_y = dx;
+                bool ahead = grid.is_walkable(x + dx, y + dy);
+                for (int s = -1; s <= 1; s += 2) {
+                    if (!grid.is_walkable(x + side_x * s, y + side_y * s)) {
+                        continue;
+                    }
+                    directions[count][0] = side_x * s;
+                    directions[count][1] = side_y * s;
+                    count++;
+                    if (ahead) {
+                        directions[count][0] = dx + side_x * s;
+                        directions[count][1] = dy + side_y * s;
+                        count++;
+                    }
+                }
+                if (ahead) {
+                    directions[count][0] = dx;
+                    directions[count][1] = dy;
+                    count++;
+                }
+            }
+        }
+
+        for (int i = 0; i < count; i++) {
+            int jump_point = _jump(grid, x + directions[i][0], y + directions[i][1], directions[i][0], directions[i][1], to);
+            if (jump_point < 0) {
+                continue;
+            }
+            // Jump points are reached along a straight or diagonal line.
+            uint32_t cost = scratch->cost[index] + _heuristic(grid, index, jump_point, true);
+            _visit(scratch, grid, jump_point, index, cost, to, true);
+        }
+    }
+}
+
+bool DungeonMapPathFinder::find_path(const Grid& grid, int from, int to, bool allow_diagonal, Vector<int>& path)
+{
+    path.clear();
+    int tile_count = grid.width * grid.height;
+    if (from < 0 || to < 0 || from >= tile_count || to >= tile_count) {
+        return false;
+    }
+    if (grid.types[from] == 0 || grid.types[to] == 0) {
+        return false;
+    }
+
+    Scratch* scratch = _acquire(tile_count);
+    bool found = allow_diagonal ? _search_8(scratch, grid, from, to) : _search_4(scratch, grid, from, to);
+
+    if (found) {
+        // Walk back from the goal, keeping only the tiles where the path turns.
+        const int* parents = scratch->parent.ptr();
+        int last_dx = 0;
+        int last_dy = 0;
+        for (int index = to; index >= 0; index = parents[index]) {
+            int parent = parents[index];
+            if (parent < 0) {
+                path.push_back(index);
+                break;
+            }
+            int dx = _sign(parent % grid.width - index % grid.width);
+            int dy = _sign(parent / grid.width - index / grid.width);
+            if (path.size() == 0 || dx != last_dx || dy != last_dy) {
+                path.push_back(index);
+            }
+            last_dx = dx;
+            last_dy = dy;
+        }
+        path.invert();
+    }
+
+    _release(scratch);
+    return found;
+}
+
+DungeonMapPathFinder::DungeonMapPathFinder()
+{
+    mutex = Mutex::create();
+}
+
+DungeonMapPathFinder::~DungeonMapPathFinder()
+{
+    for (int i = 0; i < free_scratch.size(); i++) {
+        memdelete(free_scratch[i]);
+    }
+    memdelete(mutex);
+}
@@ -0,0 +1,97 @@
+/**********************************************************
+ * Author:  Victor Holt
+ * The MIT License (MIT)
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ **********************************************************/
+
+#ifndef DUNGEON_MAP_PATH_FINDER_H
+#define DUNGEON_MAP_PATH_FINDER_H
+#include <typedefs.h>
+#include <vector.h>
+#include <os/mutex.h>
+
+#include "dungeon_map_path_grid.h"
+
+// Shortest path queries over a tile grid. Walkable tiles have a non-zero
+// type (anything but DungeonMap::EMPTY). 4-connected queries run A*,
+// 8-connected queries run jump point search (diagonal moves never cut
+// corners). Queries may run on several threads at once, each takes its own
+// search buffers from a pool that is reused between queries.
+class DungeonMapPathFinder
+{
+public:
+    // Tile grid to search (row-major, one type per tile).
+    typedef DungeonMapPathGrid Grid;
+
+private:
+
+    // Buffers for a single query.
+    struct Scratch
+    {
+        // Cost from the start to each tile.
+        Vector<uint32_t> cost;
+        // Tile each tile was reached from.
+        Vector<int> parent;
+        // Query stamp of the last query that reached each tile.
+        Vector<uint32_t> opened;
+        // Query stamp of the last query that expanded each tile.
+        Vector<uint32_t> closed;
+        // Open list (binary heap on cost).
+        DungeonMapOpenList open;
+        // Stamp of the current query.
+        uint32_t stamp = 0;
+    };
+
+    // Guards the scratch pool.
+    Mutex* mutex = NULL;
+    // Scratch buffers that aren't in use.
+    Vector<Scratch*> free_scratch;
+
+    // Takes scratch buffers from the pool, sized for the given number of tiles.
+    Scratch* _acquire(int tile_count);
+    // Returns scratch buffers to the pool.
+    void _release(Scratch* scratch);
+
+    // Opens a tile if it hasn't been reached yet or is reached at a lower cost.
+    static void _visit(Scratch* scratch, const Grid& grid, int index, int parent, uint32_t cost, int goal, bool allow_diagonal);
+
+    // Returns the estimated cost between two tiles.
+    static uint32_t _heuristic(const Grid& grid, int from, int to, bool allow_diagonal);
+    // Jumps from a tile in a direction, returns the next jump point or -1.
+    static int _jump(const Grid& grid, int x, int y, int dx, int dy, int goal);
+
+    // Runs A* over the 4-connected grid.
+    static bool _search_4(Scratch* scratch, const Grid& grid, int from, int to);
+    // Runs jump point search over the 8-connected grid.
+    static bool _search_8(Scratch* scratch, const Grid& grid, int from, int to);
+
+public:
+    // Finds the shortest path between two tiles. On success, the tiles at
+    // each turn of the path (including both ends) are written to path.
+    bool find_path(const Grid& grid, int from, int to, bool allow_diagonal, Vector<int>& path);
+
+    // Constructor.
+    DungeonMapPathFinder();
+    // Destructor.
+    ~DungeonMapPathFinder();
+};
+
+#endif
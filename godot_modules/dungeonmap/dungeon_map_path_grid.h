@@ -0,0 +1,127 @@
+/**********************************************************
+ * Author:  Victor Holt
+ * The MIT License (MIT)
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ **********************************************************/
+
+#ifndef DUNGEON_MAP_PATH_GRID_H
+#define DUNGEON_MAP_PATH_GRID_H
+#include <typedefs.h>
+#include <vector.h>
+
+// Tile grid searched by the path queries (row-major, one type per tile).
+// Walkable tiles have a non-zero type (anything but DungeonMap::EMPTY).
+struct DungeonMapPathGrid
+{
+    const uint8_t* types;
+    int width;
+    int height;
+
+    // Checks if the tile coordinates are walkable.
+    _FORCE_INLINE_ bool is_walkable(int x, int y) const
+    {
+        return x >= 0 && y >= 0 && x < width && y < height && types[y * width + x] != 0;
+    }
+};
+
+// Open list of a best-first search: a binary heap of tiles (or graph nodes)
+// on their estimated cost. The entries are kept between searches.
+class DungeonMapOpenList
+{
+    // Entry of the open list.
+    struct Entry
+    {
+        // Estimated total cost through the tile.
+        uint32_t cost;
+        // Tile index.
+        int index;
+    };
+
+    // Heap entries, only the first count are used.
+    Vector<Entry> entries;
+    // Number of entries used.
+    int count = 0;
+
+public:
+    // Empties the list (keeps its memory).
+    _FORCE_INLINE_ void clear() { count = 0; }
+    // Checks if the list is empty.
+    _FORCE_INLINE_ bool is_empty() const { return count == 0; }
+    // Returns the cost of the cheapest entry (the list must not be empty).
+    _FORCE_INLINE_ uint32_t get_min_cost() const { return entries[0].cost; }
+
+    // Adds a tile to the list.
+    void push(uint32_t cost, int index)
+    {
+        if (count == entries.size()) {
+            entries.resize(MAX(entries.size() * 2, 64));
+        }
+
+        // Sift the new entry up.
+        Entry* heap = entries.ptrw();
+        int i = count++;
+        while (i > 0) {
+            int parent = (i - 1) >> 1;
+            if (heap[parent].cost <= cost) {
+                break;
+            }
+            heap[i] = heap[parent];
+            i = parent;
+        }
+        heap[i].cost = cost;
+        heap[i].index = index;
+    }
+
+    // Removes the cheapest tile from the list, returns -1 if it's empty.
+    int pop()
+    {
+        if (count == 0) {
+            return -1;
+        }
+
+        Entry* heap = entries.ptrw();
+        int index = heap[0].index;
+        Entry last = heap[--count];
+
+        // Sift the last entry down from the root.
+        int i = 0;
+        while (true) {
+            int child = i * 2 + 1;
+            if (child >= count) {
+                break;
+            }
+            if (child + 1 < count && heap[child + 1].cost < heap[child].cost) {
+                child++;
+            }
+            if (last.cost <= heap[child].cost) {
+                break;
+            }
+            heap[i] = heap[child];
+            i = child;
+        }
+        if (count > 0) {
+            heap[i] = last;
+        }
+        return index;
+    }
+};
+
+#endif
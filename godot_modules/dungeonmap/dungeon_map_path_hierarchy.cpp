@@ -0,0 +1,375 @@
+#include "dungeon_map_path_hierarchy.h"
+
+#include <string.h>
+
+// Border runs at least this long get a portal at each end instead of one in the middle.
+#define PORTAL_SPLIT_LENGTH 6
+
+// Search states of the portal graph nodes.
+#define NODE_UNSEEN 0
+#define NODE_OPEN 1
+#define NODE_CLOSED 2
+
+void DungeonMapPathHierarchy::reset(int width, int height, int p_cluster_size)
+{
+    mutex->lock();
+    cluster_size = MAX(p_cluster_size, 1);
+    grid_width = MAX(width, 0);
+    grid_height = MAX(height, 0);
+    clusters_x = (grid_width + cluster_size - 1) / cluster_size;
+    clusters_y = (grid_height + cluster_size - 1) / cluster_size;
+
+    // Fresh clusters start out dirty.
+    clusters.clear();
+    clusters.resize(clusters_x * clusters_y);
+    node_offsets.resize(clusters.size());
+    node_count = 0;
+    offsets_dirty = true;
+
+    cluster_distances.resize(cluster_size * cluster_size);
+    cluster_queue.resize(cluster_size * cluster_size);
+    mutex->unlock();
+}
+
+void DungeonMapPathHierarchy::invalidate_tile(int x, int y)
+{
+    // Neighbors across a border share portals with the tile's cluster.
+    static const int offsets[5][2] = { { 0, 0 }, { 0, 1 }, { 1, 0 }, { 0, -1 }, { -1, 0 } };
+
+    mutex->lock();
+    for (int i = 0; i < 5; i++) {
+        int nx = x + offsets[i][0];
+        int ny = y + offsets[i][1];
+        if (nx < 0 || ny < 0 || nx >= grid_width || ny >= grid_height) {
+            continue;
+        }
+        clusters.ptrw()[_get_cluster(nx, ny)].dirty = true;
+    }
+    mutex->unlock();
+}
+
+void DungeonMapPathHierarchy::_compute_cluster_distances(const DungeonMapPathFinder::Grid& grid, int cluster, int from)
+{
+    static const int offsets[4][2] = { { 0, 1 }, { 1, 0 }, { 0, -1 }, { -1, 0 } };
+
+    int start_x = (cluster % clusters_x) * cluster_size;
+    int start_y = (cluster / clusters_x) * cluster_size;
+    int width = MIN(cluster_size, grid.width - start_x);
+    int height = MIN(cluster_size, grid.height - start_y);
+
+    uint32_t* distances = cluster_distances.ptrw();
+    int* queue = cluster_queue.ptrw();
+    for (int i = 0; i < cluster_distances.size(); i++) {
+        distances[i] = UNREACHED;
+    }
+
+    // Breadth first search, every step has the same cost.
+    int head = 0;
+    int tail = 0;
+    int local = (from / grid.width - start_y) * cluster_size + (from % grid.width - start_x);
+    distances[local] = 0;
+    queue[tail++] = local;
+
+    while (head < tail) {
+        int current = queue[head++];
+        int x = current % cluster_size;
+        int y = current / cluster_size;
+        uint32_t cost = distances[current] + STEP_COST;
+
+        for (int i = 0; i < 4; i++) {
+            int nx = x + offsets[i][0];
+            int ny = y + offsets[i][1];
+            if (nx < 0 || ny < 0 || nx >= width || ny >= height) {
+                continue;
+            }
+            int neighbor = ny * cluster_size + nx;
+            if (distances[neighbor] != UNREACHED || grid.types[(start_y + ny) * grid.width + start_x + nx] == 0) {
+                continue;
+            }
+            distances[neighbor] = cost;
+            queue[tail++] = neighbor;
+        }
+    }
+}
+
+uint32_t DungeonMapPathHierarchy::_get_cluster_distance(const DungeonMapPathFinder::Grid& grid, int cluster, int tile) const
+{
+    int start_x = (cluster % clusters_x) * cluster_size;
+    int start_y = (cluster / clusters_x) * cluster_size;
+    return cluster_distances[(tile / grid.width - start_y) * cluster_size + (tile % grid.width - start_x)];
+}
+
+void DungeonMapPathHierarchy::_add_portal(Cluster& cluster, int tile, int partner)
+{
+    // Corner tiles can be portals on two borders.
+    for (int i = 0; i < cluster.nodes.size(); i++) {
+        if (cluster.nodes[i] == tile) {
+            cluster.partners[i * 2 + 1] = partner;
+            return;
+        }
+    }
+    cluster.nodes.push_back(tile);
+    cluster.partners.push_back(partner);
+    cluster.partners.push_back(-1);
+}
+
+void DungeonMapPathHierarchy::_add_border_portals(const DungeonMapPathFinder::Grid& grid, Cluster& cluster, int x, int y, int step_x, int step_y, int length, int across_x, int across_y)
+{
+    // Both clusters walk the same pairs of tiles, so they pick matching portals.
+    int run_start = -1;
+    for (int i = 0; i <= length; i++) {
+        bool open = false;
+        if (i < length) {
+            int tx = x + i * step_x;
+            int ty = y + i * step_y;
+            open = grid.types[ty * grid.width + tx] != 0 && grid.types[(ty + across_y) * grid.width + tx + across_x] != 0;
+        }
+
+        if (open && run_start < 0) {
+            run_start = i;
+        } else if (!open && run_start >= 0) {
+            int run_end = i - 1;
+            int picks[2] = { (run_start + run_end) / 2, -1 };
+            if (run_end - run_start + 1 >= PORTAL_SPLIT_LENGTH) {
+                picks[0] = run_start;
+                picks[1] = run_end;
+            }
+            for (int p = 0; p < 2 && picks[p] >= 0; p++) {
+                int tile = (y + picks[p] * step_y) * grid.width + x + picks[p] * step_x;
+                _add_portal(cluster, tile, tile + across_y * grid.width + across_x);
+            }
+            run_start = -1;
+        }
+    }
+}
+
+void DungeonMapPathHierarchy::_build_cluster(const DungeonMapPathFinder::Grid& grid, int index)
+{
+    Cluster& cluster = clusters.ptrw()[index];
+    cluster.nodes.clear();
+    cluster.partners.clear();
+    cluster.dirty = false;
+
+    int start_x = (index % clusters_x) * cluster_size;
+    int start_y = (index / clusters_x) * cluster_size;
+    int width = MIN(cluster_size, grid.width - start_x);
+    int height = MIN(cluster_size, grid.height - start_y);
+
+    // Portals along each border that has a cluster across it.
+    if (start_y + height < grid.height) {
+        _add_border_portals(grid, cluster, start_x, start_y + height - 1, 1, 0, width, 0, 1);
+    }
+    if (start_x + width < grid.width) {
+        _add_border_portals(grid, cluster, start_x + width - 1, start_y, 0, 1, height, 1, 0);
+    }
+    if (start_y > 0) {
+        _add_border_portals(grid, cluster, start_x, start_y, 1, 0, width, 0, -1);
+    }
+    if (start_x > 0) {
+        _add_border_portals(grid, cluster, start_x, start_y, 0, 1, height, -1, 0);
+    }
+
+    // Costs between the portals, without leaving the cluster.
+    int count = cluster.nodes.size();
+    cluster.costs.resize(count * count);
+    for (int i = 0; i < count; i++) {
+        _compute_cluster_distances(grid, index, cluster.nodes[i]);
+        for (int j = 0; j < count; j++) {
+            cluster.costs[i * count + j] = _get_cluster_distance(grid, index, cluster.nodes[j]);
+        }
+    }
+}
+
+void DungeonMapPathHierarchy::_update(const DungeonMapPathFinder::Grid& grid)
+{
+    for (int i = 0; i < clusters.size(); i++) {
+        if (clusters[i].dirty) {
+            _build_cluster(grid, i);
+            offsets_dirty = true;
+        }
+    }
+    if (!offsets_dirty) {
+        return;
+    }
+    offsets_dirty = false;
+
+    // Number the portals cluster by cluster.
+    node_count = 0;
+    for (int i = 0; i < clusters.size(); i++) {
+        node_offsets[i] = node_count;
+        node_count += clusters[i].nodes.size();
+    }
+
+    // Two extra nodes for the start and the goal of a query.
+    node_tiles.resize(node_count + 2);
+    node_clusters.resize(node_count + 2);
+    node_locals.resize(node_count);
+    node_links.resize(node_count * 2);
+    node_costs.resize(node_count + 2);
+    node_parents.resize(node_count + 2);
+    node_states.resize(node_count + 2);
+
+    for (int i = 0; i < clusters.size(); i++) {
+        const Cluster& cluster = clusters[i];
+        for (int j = 0; j < cluster.nodes.size(); j++) {
+            int node = node_offsets[i] + j;
+            node_tiles[node] = cluster.nodes[j];
+            node_clusters[node] = i;
+            node_locals[node] = j;
+
+            for (int k = 0; k < 2; k++) {
+                int partner = cluster.partners[j * 2 + k];
+                node_links[node * 2 + k] = partner < 0 ? -1 : _find_node(_get_cluster(partner % grid.width, partner / grid.width), partner);
+            }
+        }
+    }
+}
+
+int DungeonMapPathHierarchy::_find_node(int cluster, int tile) const
+{
+    const Vector<int>& nodes = clusters[cluster].nodes;
+    for (int i = 0; i < nodes.size(); i++) {
+        if (nodes[i] == tile) {
+            return node_offsets[cluster] + i;
+        }
+    }
+    return -1;
+}
+
+void DungeonMapPathHierarchy::_visit(int width, int node, int parent, uint32_t cost, int goal)
+{
+    uint8_t state = node_states[node];
+    if (state == NODE_CLOSED || (state == NODE_OPEN && node_costs[node] <= cost)) {
+        return;
+    }
+
+    // Nodes reached at a lower cost are pushed again, the stale entry is skipped when popped.
+    node_states[node] = NODE_OPEN;
+    node_costs[node] = cost;
+    node_parents[node] = parent;
+    open.push(cost + _heuristic(width, node_tiles[node], node_tiles[goal]), node);
+}
+
+bool DungeonMapPathHierarchy::find_path(const DungeonMapPathFinder::Grid& grid, int from, int to, Vector<int>& path)
+{
+    path.clear();
+
+    int tile_count = grid.width * grid.height;
+    if (from < 0 || to < 0 || from >= tile_count || to >= tile_count) {
+        return false;
+    }
+    if (grid.types[from] == 0 || grid.types[to] == 0) {
+        return false;
+    }
+    if (from == to) {
+        path.push_back(from);
+        return true;
+    }
+
+    mutex->lock();
+    if (grid.width != grid_width || grid.height != grid_height) {
+        mutex->unlock();
+        ERR_EXPLAIN("The path hierarchy wasn't reset for the grid");
+        ERR_FAIL_V(false);
+    }
+    _update(grid);
+
+    int start = node_count;
+    int goal = node_count + 1;
+    int start_cluster = _get_cluster(from % grid.width, from / grid.width);
+    int goal_cluster = _get_cluster(to % grid.width, to / grid.width);
+    node_tiles[start] = from;
+    node_tiles[goal] = to;
+    node_clusters[start] = start_cluster;
+    node_clusters[goal] = goal_cluster;
+
+    // Costs between the end tiles and the portals of their clusters.
+    const Cluster& start_nodes = clusters[start_cluster];
+    const Cluster& goal_nodes = clusters[goal_cluster];
+    _compute_cluster_distances(grid, start_cluster, from);
+    start_costs.resize(start_nodes.nodes.size());
+    for (int i = 0; i < start_nodes.nodes.size(); i++) {
+        start_costs[i] = _get_cluster_distance(grid, start_cluster, start_nodes.nodes[i]);
+    }
+    uint32_t direct_cost = start_cluster == goal_cluster ? _get_cluster_distance(grid, start_cluster, to) : UNREACHED;
+    _compute_cluster_distances(grid, goal_cluster, to);
+    goal_costs.resize(goal_nodes.nodes.size());
+    for (int i = 0; i < goal_nodes.nodes.size(); i++) {
+        goal_costs[i] = _get_cluster_distance(grid, goal_cluster, goal_nodes.nodes[i]);
+    }
+
+    memset(node_states.ptrw(), NODE_UNSEEN, node_states.size());
+    open.clear();
+
+    // A* over the portal graph, starting from the start tile's edges.
+    node_states[start] = NODE_CLOSED;
+    node_costs[start] = 0;
+    node_parents[start] = -1;
+    if (direct_cost != UNREACHED) {
+        _visit(grid.width, goal, start, direct_cost, goal);
+    }
+    for (int i = 0; i < start_costs.size(); i++) {
+        if (start_costs[i] != UNREACHED) {
+            _visit(grid.width, node_offsets[start_cluster] + i, start, start_costs[i], goal);
+        }
+    }
+
+    bool found = false;
+    while (!open.is_empty()) {
+        uint32_t estimate = open.get_min_cost();
+        int node = open.pop();
+        if (node_states[node] == NODE_CLOSED || estimate != node_costs[node] + _heuristic(grid.width, node_tiles[node], to)) {
+            continue;
+        }
+        if (node == goal) {
+            found = true;
+            break;
+        }
+        node_states[node] = NODE_CLOSED;
+
+        uint32_t cost = node_costs[node];
+        int cluster = node_clusters[node];
+        int local = node_locals[node];
+        const Cluster& current = clusters[cluster];
+        int count = current.nodes.size();
+
+        // Portals of the same cluster.
+        const uint32_t* costs = current.costs.ptr() + local * count;
+        for (int i = 0; i < count; i++) {
+            if (i != local && costs[i] != UNREACHED) {
+                _visit(grid.width, node_offsets[cluster] + i, node, cost + costs[i], goal);
+            }
+        }
+        // Portals across the borders.
+        for (int i = 0; i < 2; i++) {
+            int link = node_links[node * 2 + i];
+            if (link >= 0) {
+                _visit(grid.width, link, node, cost + STEP_COST, goal);
+            }
+        }
+        // The goal, from the portals of its cluster.
+        if (cluster == goal_cluster && goal_costs[local] != UNREACHED) {
+            _visit(grid.width, goal, node, cost + goal_costs[local], goal);
+        }
+    }
+
+    if (found) {
+        for (int node = goal; node >= 0; node = node_parents[node]) {
+            path.push_back(node_tiles[node]);
+        }
+        path.invert();
+    }
+    mutex->unlock();
+
+    return found;
+}
+
+DungeonMapPathHierarchy::DungeonMapPathHierarchy()
+{
+    mutex = Mutex::create();
+}
+
+DungeonMapPathHierarchy::~DungeonMapPathHierarchy()
+{
+    memdelete(mutex);
+}
@@ -0,0 +1,150 @@
+/**********************************************************
+ * Author:  Victor Holt
+ * The MIT License (MIT)
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ **********************************************************/
+
+#ifndef DUNGEON_MAP_PATH_HIERARCHY_H
+#define DUNGEON_MAP_PATH_HIERARCHY_H
+#include <typedefs.h>
+#include <vector.h>
+#include <os/mutex.h>
+
+#include "dungeon_map_path_finder.h"
+
+// Hierarchical path planning (HPA*) over 4-connected tiles. The grid is cut
+// into square clusters (the map regions). Portals are placed where walkable
+// tiles cross a cluster border, and the costs between the portals of each
+// cluster are cached. Long queries search the portal graph instead of the
+// tiles. Clusters are rebuilt lazily after their tiles change.
+class DungeonMapPathHierarchy
+{
+    // Portals and cached costs of a single cluster.
+    struct Cluster
+    {
+        // Portal tiles inside the cluster.
+        Vector<int> nodes;
+        // Tiles across the border from each portal (two per portal, -1 if unused).
+        Vector<int> partners;
+        // Cost between every pair of portals (nodes x nodes, UNREACHED if not connected inside the cluster).
+        Vector<uint32_t> costs;
+        // Flag for whether or not the portals and costs need to be rebuilt.
+        bool dirty = true;
+    };
+
+
+    // Clusters, row-major by cluster coordinates.
+    Vector<Cluster> clusters;
+    // Size of a cluster in tiles.
+    int cluster_size = 0;
+    // Number of clusters along each axis.
+    int clusters_x = 0;
+    int clusters_y = 0;
+    // Size of the grid the clusters were built for.
+    int grid_width = 0;
+    int grid_height = 0;
+
+    // Id of the first node of each cluster in the portal graph.
+    Vector<int> node_offsets;
+    // Number of portal nodes in the graph.
+    int node_count = 0;
+    // Tile and cluster of every node (the start and the goal follow the portals).
+    Vector<int> node_tiles;
+    Vector<int> node_clusters;
+    // Index of every portal node inside of its cluster.
+    Vector<int> node_locals;
+    // Nodes across the border from every portal node (two per node, -1 if unused).
+    Vector<int> node_links;
+    // Flag for whether or not the node ids need to be reassigned.
+    bool offsets_dirty = true;
+
+    // Serializes queries (clusters are rebuilt during a query).
+    Mutex* mutex = NULL;
+
+    // Distances from a tile to the tiles of its cluster (local to the cluster).
+    Vector<uint32_t> cluster_distances;
+    // Breadth first queue (local to the cluster).
+    Vector<int> cluster_queue;
+    // Costs from the start tile and to the goal tile for the portals of their clusters.
+    Vector<uint32_t> start_costs;
+    Vector<uint32_t> goal_costs;
+
+    // Search state per node of the portal graph (plus the start and the goal).
+    Vector<uint32_t> node_costs;
+    Vector<int> node_parents;
+    Vector<uint8_t> node_states;
+    // Open list (binary heap on cost).
+    DungeonMapOpenList open;
+
+    // Returns the cluster of a tile.
+    _FORCE_INLINE_ int _get_cluster(int x, int y) const { return (y / cluster_size) * clusters_x + x / cluster_size; }
+
+    // Fills cluster_distances with the 4-connected distances from a tile to
+    // every tile of its cluster, without leaving the cluster.
+    void _compute_cluster_distances(const DungeonMapPathFinder::Grid& grid, int cluster, int from);
+    // Returns a distance computed by _compute_cluster_distances.
+    uint32_t _get_cluster_distance(const DungeonMapPathFinder::Grid& grid, int cluster, int tile) const;
+
+    // Adds a portal to a cluster (portals on two borders are only added once).
+    static void _add_portal(Cluster& cluster, int tile, int partner);
+    // Adds the portals along one border of a cluster.
+    void _add_border_portals(const DungeonMapPathFinder::Grid& grid, Cluster& cluster, int x, int y, int step_x, int step_y, int length, int across_x, int across_y);
+    // Rebuilds the portals and costs of a cluster.
+    void _build_cluster(const DungeonMapPathFinder::Grid& grid, int cluster);
+    // Rebuilds every dirty cluster and reassigns the node ids.
+    void _update(const DungeonMapPathFinder::Grid& grid);
+    // Returns the node id of a portal tile in a cluster, or -1.
+    int _find_node(int cluster, int tile) const;
+    // Returns the estimated cost between two tiles.
+    _FORCE_INLINE_ uint32_t _heuristic(int width, int from, int to) const
+    {
+        return (ABS(from % width - to % width) + ABS(from / width - to / width)) * STEP_COST;
+    }
+
+    // Opens a node if it hasn't been reached yet or is reached at a lower cost.
+    void _visit(int width, int node, int parent, uint32_t cost, int goal);
+
+public:
+    // Cost of a single step.
+    static const uint32_t STEP_COST = 10;
+    // Cost of unreachable portals.
+    static const uint32_t UNREACHED = 0xffffffff;
+
+    // Cuts a grid of the given size into clusters, all of them are built on the next query.
+    void reset(int width, int height, int p_cluster_size);
+    // Marks the clusters touching a tile (its own and those across a border) for rebuilding.
+    void invalidate_tile(int x, int y);
+
+    // Finds a path between two tiles over the portal graph. The tiles of the
+    // path (start, portals, goal) are written to path, consecutive tiles are
+    // connected inside a single cluster or across a border.
+    bool find_path(const DungeonMapPathFinder::Grid& grid, int from, int to, Vector<int>& path);
+
+    // Returns the number of portal nodes (after the last query).
+    _FORCE_INLINE_ int get_node_count() const { return node_count; }
+
+    // Constructor.
+    DungeonMapPathHierarchy();
+    // Destructor.
+    ~DungeonMapPathHierarchy();
+};
+
+#endif
@@ -0,0 +1,113 @@
+#include "dungeon_map_path_queue.h"
+
+int DungeonMapPathQueue::push(int goal_tile, const Vector3& from, const Vector3& to, bool allow_diagonal, uint64_t usec)
+{
+    Request request;
+    request.ticket = next_ticket++;
+    request.goal_tile = goal_tile;
+    request.from = from;
+    request.to = to;
+    request.allow_diagonal = allow_diagonal;
+    request.queued_usec = usec;
+    pending.push_back(request);
+
+    // Tickets stay positive, 0 is never handed out.
+    if (next_ticket <= 0) {
+        next_ticket = 1;
+    }
+    return request.ticket;
+}
+
+bool DungeonMapPathQueue::cancel(int ticket)
+{
+    for (int i = 0; i < pending.size(); i++) {
+        if (pending[i].ticket == ticket) {
+            pending.remove(i);
+            return true;
+        }
+    }
+    return results.erase(ticket);
+}
+
+int DungeonMapPathQueue::pop_group(Vector<Request>& group)
+{
+    group.clear();
+    if (pending.size() == 0) {
+        return 0;
+    }
+
+    // Matching requests move to the group, the rest are packed down in order.
+    Request* requests = pending.ptrw();
+    int goal_tile = requests[0].goal_tile;
+    bool allow_diagonal = requests[0].allow_diagonal;
+    int kept = 0;
+    for (int i = 0; i < pending.size(); i++) {
+        if (requests[i].goal_tile == goal_tile && requests[i].allow_diagonal == allow_diagonal) {
+            group.push_back(requests[i]);
+        } else {
+            requests[kept++] = requests[i];
+        }
+    }
+    pending.resize(kept);
+    return group.size();
+}
+
+void DungeonMapPathQueue::finish(const Request& request, const PoolVector3Array& points, bool shared, uint64_t usec)
+{
+    results[request.ticket] = points;
+
+    uint64_t latency = usec > request.queued_usec ? usec - request.queued_usec : 0;
+    total_latency_usec += latency;
+    max_latency_usec = MAX(max_latency_usec, latency);
+    served_count++;
+    if (shared) {
+        shared_count++;
+    }
+}
+
+void DungeonMapPathQueue::finish_frame(uint64_t usec, int count)
+{
+    frame_usec = usec;
+    frame_count = count;
+}
+
+PoolVector3Array DungeonMapPathQueue::take(int ticket)
+{
+    PoolVector3Array points;
+    Map<int, PoolVector3Array>::Element* result = results.find(ticket);
+    if (result) {
+        points = result->get();
+        results.erase(ticket);
+    }
+    return points;
+}
+
+void DungeonMapPathQueue::clear()
+{
+    pending.clear();
+    results.clear();
+}
+
+void DungeonMapPathQueue::reset_stats()
+{
+    served_count = 0;
+    shared_count = 0;
+    total_latency_usec = 0;
+    max_latency_usec = 0;
+    frame_usec = 0;
+    frame_count = 0;
+}
+
+Dictionary DungeonMapPathQueue::get_stats() const
+{
+    Dictionary stats;
+    stats["pending"] = pending.size();
+    stats["results"] = results.size();
+    stats["served"] = (int64_t)served_count;
+    stats["shared"] = (int64_t)shared_count;
+    stats["average_latency_usec"] = (int64_t)(served_count > 0 ? total_latency_usec / served_count : 0);
+    stats["max_latency_usec"] = (int64_t)max_latency_usec;
+    stats["frame_usec"] = (int64_t)frame_usec;
+    stats["frame_served"] = frame_count;
+    return stats;
+}
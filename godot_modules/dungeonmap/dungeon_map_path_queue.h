@@ -0,0 +1,106 @@
+/**********************************************************
+ * Author:  Victor Holt
+ * The MIT License (MIT)
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ **********************************************************/
+
+#ifndef DUNGEON_MAP_PATH_QUEUE_H
+#define DUNGEON_MAP_PATH_QUEUE_H
+#include <typedefs.h>
+#include <vector.h>
+#include <map.h>
+#include <dictionary.h>
+#include <variant.h>
+
+// Path requests waiting to be searched and the paths found for them.
+// Requests are identified by tickets. Pending requests that share a goal
+// tile are handed out as a single group so one search can serve all of
+// them. Results stay in the queue until they're taken. Main thread only.
+class DungeonMapPathQueue
+{
+public:
+    // A single path request.
+    struct Request
+    {
+        // Ticket identifying the request.
+        int ticket;
+        // Goal tile when the request was made (requests are grouped by it).
+        int goal_tile;
+        // Start and end positions.
+        Vector3 from;
+        Vector3 to;
+        // Flag for whether or not the path may move diagonally.
+        bool allow_diagonal;
+        // Time the request was made (microseconds).
+        uint64_t queued_usec;
+    };
+
+private:
+    // Requests waiting to be searched, oldest first.
+    Vector<Request> pending;
+    // Paths found for the requests that haven't been taken yet.
+    Map<int, PoolVector3Array> results;
+    // Ticket of the next request.
+    int next_ticket = 1;
+
+    // Number of requests served.
+    uint64_t served_count = 0;
+    // Number of requests served by a search shared with other requests.
+    uint64_t shared_count = 0;
+    // Time between making and serving the requests (microseconds).
+    uint64_t total_latency_usec = 0;
+    uint64_t max_latency_usec = 0;
+    // Time spent and requests served in the last frame.
+    uint64_t frame_usec = 0;
+    int frame_count = 0;
+
+public:
+    // Adds a request, returns its ticket.
+    int push(int goal_tile, const Vector3& from, const Vector3& to, bool allow_diagonal, uint64_t usec);
+    // Removes a pending request or an untaken result. Returns false if the ticket is unknown.
+    bool cancel(int ticket);
+    // Moves the oldest request and every pending request with the same
+    // goal tile (and diagonal flag) into group. Returns the group size.
+    int pop_group(Vector<Request>& group);
+    // Stores the path found for a request.
+    void finish(const Request& request, const PoolVector3Array& points, bool shared, uint64_t usec);
+    // Records the time spent and the requests served in a frame.
+    void finish_frame(uint64_t usec, int count);
+
+    // Checks if the path for a ticket was found (or failed) and can be taken.
+    _FORCE_INLINE_ bool is_ready(int ticket) const { return results.has(ticket); }
+    // Returns and removes the path for a ticket (empty if it isn't ready or there is no path).
+    PoolVector3Array take(int ticket);
+
+    // Returns the number of requests waiting to be searched.
+    _FORCE_INLINE_ int get_pending_count() const { return pending.size(); }
+    // Returns the number of paths waiting to be taken.
+    _FORCE_INLINE_ int get_result_count() const { return results.size(); }
+
+    // Drops every request and result.
+    void clear();
+    // Resets the statistics.
+    void reset_stats();
+    // Returns the queue depth and latency statistics as a Dictionary.
+    Dictionary get_stats() const;
+};
+
+#endif
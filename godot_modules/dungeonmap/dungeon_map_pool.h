@@ -0,0 +1,92 @@
+/**********************************************************
+ * Author:  Victor Holt
+ * The MIT License (MIT)
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ **********************************************************/
+
+#ifndef DUNGEON_MAP_POOL_H
+#define DUNGEON_MAP_POOL_H
+#include <typedefs.h>
+#include <vector.h>
+
+// Slab pool for objects that are rebuilt on every generation. Objects live in
+// fixed-size blocks that are kept across resets, so pointers stay valid until
+// the next reset and a regeneration reuses the memory of the previous one.
+template <class T, int BLOCK_SIZE = 64>
+class DungeonMapPool
+{
+    // Blocks of BLOCK_SIZE objects.
+    Vector<T*> blocks;
+    // Number of objects in use.
+    int used = 0;
+
+    // The pool owns its blocks.
+    DungeonMapPool(const DungeonMapPool&);
+    DungeonMapPool& operator=(const DungeonMapPool&);
+
+public:
+    // Returns the next free object, allocating a new block when the pool is full.
+    T* alloc()
+    {
+        if (used == blocks.size() * BLOCK_SIZE) {
+            blocks.push_back(memnew_arr(T, BLOCK_SIZE));
+        }
+        T* item = get(used);
+        used++;
+        return item;
+    }
+
+    // Resets the objects in use and returns them to the pool (keeps the blocks).
+    void reset()
+    {
+        for (int i = 0; i < used; i++) {
+            *get(i) = T();
+        }
+        used = 0;
+    }
+
+    // Frees all blocks.
+    void free()
+    {
+        reset();
+        for (int i = 0; i < blocks.size(); i++) {
+            memdelete_arr(blocks[i]);
+        }
+        blocks.clear();
+    }
+
+    // Returns an object in use.
+    _FORCE_INLINE_ T* get(int index) const { return blocks[index / BLOCK_SIZE] + (index % BLOCK_SIZE); }
+    // Returns an object in use.
+    _FORCE_INLINE_ T* operator[](int index) const { return get(index); }
+
+    // Returns the number of objects in use.
+    _FORCE_INLINE_ int size() const { return used; }
+    // Returns the number of objects that fit in the allocated blocks.
+    _FORCE_INLINE_ int get_capacity() const { return blocks.size() * BLOCK_SIZE; }
+
+    // Constructor.
+    DungeonMapPool() {}
+    // Destructor.
+    ~DungeonMapPool() { free(); }
+};
+
+#endif
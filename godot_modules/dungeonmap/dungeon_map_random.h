@@ -0,0 +1,87 @@
+/**********************************************************
+ * Author:  Victor Holt
+ * The MIT License (MIT)
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ **********************************************************/
+
+#ifndef DUNGEON_MAP_RANDOM_H
+#define DUNGEON_MAP_RANDOM_H
+#include <typedefs.h>
+
+// Small PCG32 generator owned by a builder/map instance so that generation
+// doesn't depend on (or disturb) the engine's global random state.
+class DungeonMapRandom
+{
+    // Current generator state.
+    uint64_t state = 0x853c49e6748fea9bULL;
+    // Stream increment (always odd).
+    uint64_t inc = 0xda3e39cb94b95bdbULL;
+
+public:
+    // Seeds the generator. Different streams produce independent sequences for the same seed.
+    _FORCE_INLINE_ void seed(uint64_t p_seed, uint64_t p_stream = 0)
+    {
+        state = 0;
+        inc = (p_stream << 1) | 1;
+        rand();
+        state += p_seed;
+        rand();
+    }
+
+    // Returns the next 32-bit random value.
+    _FORCE_INLINE_ uint32_t rand()
+    {
+        uint64_t old_state = state;
+        state = old_state * 6364136223846793005ULL + inc;
+        uint32_t xorshifted = (uint32_t)(((old_state >> 18) ^ old_state) >> 27);
+        uint32_t rot = (uint32_t)(old_state >> 59);
+        return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+    }
+
+    // Returns a random value in [0, bound) without modulo bias.
+    _FORCE_INLINE_ uint32_t rand(uint32_t bound)
+    {
+        if (bound == 0) {
+            return 0;
+        }
+        uint32_t threshold = (-bound) % bound;
+        for (;;) {
+            uint32_t r = rand();
+            if (r >= threshold) {
+                return r % bound;
+            }
+        }
+    }
+
+    // Returns a random integer in [from, to] (inclusive).
+    _FORCE_INLINE_ int random(int from, int to)
+    {
+        if (to <= from) {
+            return from;
+        }
+        return from + (int)rand((uint32_t)(to - from) + 1);
+    }
+
+    // Returns a random float in [0, 1).
+    _FORCE_INLINE_ float randf() { return (rand() >> 8) * (1.0f / 16777216.0f); }
+};
+
+#endif
@@ -0,0 +1,78 @@
+#include "dungeon_map_raycast.h"
+
+#include <math/math_funcs.h>
+
+// Returns the index of a tile, or -1 if it's outside of the grid.
+static _FORCE_INLINE_ int _get_tile(const DungeonMapPathFinder::Grid& grid, int x, int y)
+{
+    return (x < 0 || y < 0 || x >= grid.width || y >= grid.height) ? -1 : y * grid.width + x;
+}
+
+// Checks if a tile blocks rays.
+static _FORCE_INLINE_ bool _is_blocking(const DungeonMapPathFinder::Grid& grid, int x, int y)
+{
+    int tile = _get_tile(grid, x, y);
+    return tile < 0 || grid.types[tile] == 0;
+}
+
+bool DungeonMapRaycast::cast(const DungeonMapPathFinder::Grid& grid, const Vector2& from, const Vector2& to, Hit* r_hit)
+{
+    int x = (int)Math::floor(from.x);
+    int y = (int)Math::floor(from.y);
+    int end_x = (int)Math::floor(to.x);
+    int end_y = (int)Math::floor(to.y);
+
+    if (_is_blocking(grid, x, y)) {
+        if (r_hit) {
+            r_hit->tile = _get_tile(grid, x, y);
+            r_hit->fraction = 0.0f;
+            r_hit->normal_x = 0;
+            r_hit->normal_y = 0;
+        }
+        return true;
+    }
+
+    // Distance along the ray to the next tile border on each axis, and
+    // between two borders on the same axis.
+    float dx = to.x - from.x;
+    float dy = to.y - from.y;
+    int step_x = (dx > 0.0f) - (dx < 0.0f);
+    int step_y = (dy > 0.0f) - (dy < 0.0f);
+    float delta_x = step_x ? 1.0f / Math::abs(dx) : 1e30f;
+    float delta_y = step_y ? 1.0f / Math::abs(dy) : 1e30f;
+    float next_x = step_x > 0 ? (x + 1 - from.x) * delta_x : (step_x < 0 ? (from.x - x) * delta_x : 1e30f);
+    float next_y = step_y > 0 ? (y + 1 - from.y) * delta_y : (step_y < 0 ? (from.y - y) * delta_y : 1e30f);
+
+    // Every step crosses one border, which bounds the walk even with rounding errors.
+    int steps = ABS(end_x - x) + ABS(end_y - y);
+    for (int i = 0; i < steps; i++) {
+        float fraction;
+        int normal_x = 0;
+        int normal_y = 0;
+        if (next_x < next_y) {
+            fraction = next_x;
+            next_x += delta_x;
+            x += step_x;
+            normal_x = -step_x;
+        } else {
+            fraction = next_y;
+            next_y += delta_y;
+            y += step_y;
+            normal_y = -step_y;
+        }
+        if (fraction > 1.0f) {
+            break;
+        }
+
+        if (_is_blocking(grid, x, y)) {
+            if (r_hit) {
+                r_hit->tile = _get_tile(grid, x, y);
+                r_hit->fraction = fraction;
+                r_hit->normal_x = normal_x;
+                r_hit->normal_y = normal_y;
+            }
+            return true;
+        }
+    }
+    return false;
+}
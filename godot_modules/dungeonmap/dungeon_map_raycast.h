@@ -0,0 +1,63 @@
+/**********************************************************
+ * Author:  Victor Holt
+ * The MIT License (MIT)
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ **********************************************************/
+
+#ifndef DUNGEON_MAP_RAYCAST_H
+#define DUNGEON_MAP_RAYCAST_H
+#include <typedefs.h>
+#include <math/math_2d.h>
+
+#include "dungeon_map_path_finder.h"
+
+// Rays and lines of sight over a tile grid (Amanatides-Woo traversal).
+// Rays are cast in grid space, one unit per tile with tile (x, y) covering
+// [x, x + 1) x [y, y + 1). Empty tiles and everything outside of the grid
+// block rays. Casts don't allocate or lock, so any number of threads can
+// cast against a grid that isn't being modified.
+class DungeonMapRaycast
+{
+public:
+    // First blocking tile along a ray.
+    struct Hit
+    {
+        // Index of the blocking tile (-1 outside of the grid).
+        int tile;
+        // Distance along the ray to the hit (0 at the start, 1 at the end).
+        float fraction;
+        // Side of the tile that was hit, as a grid space normal (zero if the ray starts inside of it).
+        int normal_x;
+        int normal_y;
+    };
+
+    // Casts a ray between two grid space positions. Returns true and fills
+    // r_hit (if given) when a blocking tile is crossed before the end.
+    static bool cast(const DungeonMapPathFinder::Grid& grid, const Vector2& from, const Vector2& to, Hit* r_hit = NULL);
+
+    // Checks if nothing blocks the line between two grid space positions.
+    static _FORCE_INLINE_ bool has_line_of_sight(const DungeonMapPathFinder::Grid& grid, const Vector2& from, const Vector2& to)
+    {
+        return !cast(grid, from, to);
+    }
+};
+
+#endif
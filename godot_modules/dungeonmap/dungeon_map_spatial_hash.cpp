@@ -0,0 +1,213 @@
+#include "dungeon_map_spatial_hash.h"
+
+void DungeonMapSpatialHash::_link(int slot)
+{
+    Entity& entity = entities.ptrw()[slot];
+    entity.tile_prev = -1;
+    entity.tile_next = -1;
+    entity.region_prev = -1;
+    entity.region_next = -1;
+    if (entity.tile < 0) {
+        return;
+    }
+
+    // New entities go to the front of both lists.
+    int* tiles = tile_heads.ptrw();
+    int* regions = region_heads.ptrw();
+    entity.tile_next = tiles[entity.tile];
+    if (entity.tile_next >= 0) {
+        entities.ptrw()[entity.tile_next].tile_prev = slot;
+    }
+    tiles[entity.tile] = slot;
+
+    entity.region_next = regions[entity.region];
+    if (entity.region_next >= 0) {
+        entities.ptrw()[entity.region_next].region_prev = slot;
+    }
+    regions[entity.region] = slot;
+}
+
+void DungeonMapSpatialHash::_unlink(int slot)
+{
+    Entity* items = entities.ptrw();
+    Entity& entity = items[slot];
+    if (entity.tile < 0) {
+        return;
+    }
+
+    if (entity.tile_prev >= 0) {
+        items[entity.tile_prev].tile_next = entity.tile_next;
+    } else {
+        tile_heads.ptrw()[entity.tile] = entity.tile_next;
+    }
+    if (entity.tile_next >= 0) {
+        items[entity.tile_next].tile_prev = entity.tile_prev;
+    }
+
+    if (entity.region_prev >= 0) {
+        items[entity.region_prev].region_next = entity.region_next;
+    } else {
+        region_heads.ptrw()[entity.region] = entity.region_next;
+    }
+    if (entity.region_next >= 0) {
+        items[entity.region_next].region_prev = entity.region_prev;
+    }
+}
+
+void DungeonMapSpatialHash::_place(int slot)
+{
+    Entity& entity = entities.ptrw()[slot];
+    entity.tile = -1;
+    entity.region = -1;
+
+    if (tile_size > 0.0f) {
+        int x, y;
+        _get_tile_coords(entity.position.x, entity.position.z, x, y);
+        if (x >= 0 && y >= 0 && x < width && y < height) {
+            entity.tile = y * width + x;
+            entity.region = (y / tiles_per_region) * regions_x + x / tiles_per_region;
+        }
+    }
+    _link(slot);
+}
+
+void DungeonMapSpatialHash::reset(int p_width, int p_height, int p_tiles_per_region, float p_tile_size)
+{
+    width = MAX(p_width, 0);
+    height = MAX(p_height, 0);
+    tiles_per_region = MAX(p_tiles_per_region, 1);
+    tile_size = p_tile_size;
+    regions_x = (width + tiles_per_region - 1) / tiles_per_region;
+    int regions_y = (height + tiles_per_region - 1) / tiles_per_region;
+
+    tile_heads.resize(width * height);
+    region_heads.resize(regions_x * regions_y);
+    for (int i = 0; i < tile_heads.size(); i++) {
+        tile_heads.ptrw()[i] = -1;
+    }
+    for (int i = 0; i < region_heads.size(); i++) {
+        region_heads.ptrw()[i] = -1;
+    }
+
+    // Every entity is placed again on the new map.
+    const int64_t* id = NULL;
+    while ((id = slots.next(id))) {
+        _place(slots[*id]);
+    }
+}
+
+void DungeonMapSpatialHash::update(int64_t id, const Vector3& position)
+{
+    int* existing = slots.getptr(id);
+    int slot;
+    if (existing) {
+        slot = *existing;
+
+        // Moving within a tile doesn't touch the lists.
+        Entity& entity = entities.ptrw()[slot];
+        int x, y;
+        if (tile_size > 0.0f && entity.tile >= 0) {
+            _get_tile_coords(position.x, position.z, x, y);
+            if (x >= 0 && y >= 0 && x < width && y < height && y * width + x == entity.tile) {
+                entity.position = position;
+                return;
+            }
+        }
+        _unlink(slot);
+    } else if (free_slots.size() > 0) {
+        slot = free_slots[free_slots.size() - 1];
+        free_slots.resize(free_slots.size() - 1);
+        slots.set(id, slot);
+    } else {
+        slot = entities.size();
+        entities.resize(slot + 1);
+        slots.set(id, slot);
+    }
+
+    Entity& entity = entities.ptrw()[slot];
+    entity.id = id;
+    entity.position = position;
+    _place(slot);
+}
+
+bool DungeonMapSpatialHash::remove(int64_t id)
+{
+    int* slot = slots.getptr(id);
+    if (!slot) {
+        return false;
+    }
+    _unlink(*slot);
+    entities.ptrw()[*slot].tile = -1;
+    free_slots.push_back(*slot);
+    slots.erase(id);
+    return true;
+}
+
+void DungeonMapSpatialHash::clear()
+{
+    entities.clear();
+    free_slots.clear();
+    slots.clear();
+    for (int i = 0; i < tile_heads.size(); i++) {
+        tile_heads.ptrw()[i] = -1;
+    }
+    for (int i = 0; i < region_heads.size(); i++) {
+        region_heads.ptrw()[i] = -1;
+    }
+}
+
+Vector3 DungeonMapSpatialHash::get_position(int64_t id) const
+{
+    const int* slot = slots.getptr(id);
+    return slot ? entities[*slot].position : Vector3();
+}
+
+void DungeonMapSpatialHash::query_radius(const Vector3& position, float radius, Vector<int64_t>& r_ids) const
+{
+    if (tile_size <= 0.0f || radius < 0.0f) {
+        return;
+    }
+
+    // Tiles overlapping the square around the circle (tile y grows towards -z).
+    int min_x, min_y, max_x, max_y;
+    _get_tile_coords(position.x - radius, position.z + radius, min_x, min_y);
+    _get_tile_coords(position.x + radius, position.z - radius, max_x, max_y);
+    min_x = MAX(min_x, 0);
+    min_y = MAX(min_y, 0);
+    max_x = MIN(max_x, width - 1);
+    max_y = MIN(max_y, height - 1);
+
+    const Entity* items = entities.ptr();
+    const int* tiles = tile_heads.ptr();
+    float radius_squared = radius * radius;
+    for (int y = min_y; y <= max_y; y++) {
+        for (int x = min_x; x <= max_x; x++) {
+            for (int slot = tiles[y * width + x]; slot >= 0; slot = items[slot].tile_next) {
+                float dx = items[slot].position.x - position.x;
+                float dz = items[slot].position.z - position.z;
+                if (dx * dx + dz * dz <= radius_squared) {
+                    r_ids.push_back(items[slot].id);
+                }
+            }
+        }
+    }
+}
+
+void DungeonMapSpatialHash::query_region(const Vector2& position, Vector<int64_t>& r_ids) const
+{
+    if (tile_size <= 0.0f) {
+        return;
+    }
+
+    int x, y;
+    _get_tile_coords(position.x, position.y, x, y);
+    if (x < 0 || y < 0 || x >= width || y >= height) {
+        return;
+    }
+
+    const Entity* items = entities.ptr();
+    int region = (y / tiles_per_region) * regions_x + x / tiles_per_region;
+    for (int slot = region_heads[region]; slot >= 0; slot = items[slot].region_next) {
+        r_ids.push_back(items[slot].id);
+    }
+}
@@ -0,0 +1,114 @@
+/**********************************************************
+ * Author:  Victor Holt
+ * The MIT License (MIT)
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ **********************************************************/
+
+#ifndef DUNGEON_MAP_SPATIAL_HASH_H
+#define DUNGEON_MAP_SPATIAL_HASH_H
+#include <typedefs.h>
+#include <vector.h>
+#include <hash_map.h>
+#include <math/math_funcs.h>
+#include <math/math_2d.h>
+#include <math/vector3.h>
+
+// Positions of moving entities bucketed by tile and by region. Each tile
+// and region keeps a linked list of the entities on it, so radius and
+// region queries only visit the entities nearby. Entities off the map are
+// kept but not returned by queries. Main thread only.
+class DungeonMapSpatialHash
+{
+    // A registered entity.
+    struct Entity
+    {
+        // Id the entity was registered with.
+        int64_t id;
+        // Last position of the entity.
+        Vector3 position;
+        // Tile and region the entity is on (-1 off the map).
+        int tile;
+        int region;
+        // Neighbors in the tile and region lists (-1 at the ends).
+        int tile_prev;
+        int tile_next;
+        int region_prev;
+        int region_next;
+    };
+
+    // Entity slots (free slots are reused).
+    Vector<Entity> entities;
+    // Slots that aren't in use.
+    Vector<int> free_slots;
+    // Slot of each entity id.
+    HashMap<int64_t, int> slots;
+
+    // First entity on each tile and region (-1 if there's none).
+    Vector<int> tile_heads;
+    Vector<int> region_heads;
+
+    // Size of the map in tiles.
+    int width = 0;
+    int height = 0;
+    // Tiles per region along each axis.
+    int tiles_per_region = 1;
+    // Number of regions along the x axis.
+    int regions_x = 0;
+    // Size of a single tile.
+    float tile_size = 0.0f;
+
+    // Returns the tile coordinates of a position (may be off the map).
+    _FORCE_INLINE_ void _get_tile_coords(float x, float z, int& r_x, int& r_y) const
+    {
+        r_x = (int)Math::floor(x / tile_size);
+        r_y = (int)Math::floor(z * -1.0f / tile_size);
+    }
+
+    // Adds an entity to the lists of its tile and region.
+    void _link(int slot);
+    // Removes an entity from the lists of its tile and region.
+    void _unlink(int slot);
+    // Finds the tile and region of an entity and links it.
+    void _place(int slot);
+
+public:
+    // Resizes the buckets for a map and re-buckets every entity.
+    void reset(int p_width, int p_height, int p_tiles_per_region, float p_tile_size);
+
+    // Adds an entity or moves it to a new position.
+    void update(int64_t id, const Vector3& position);
+    // Removes an entity. Returns false if it wasn't registered.
+    bool remove(int64_t id);
+    // Removes every entity.
+    void clear();
+
+    // Returns the number of registered entities.
+    _FORCE_INLINE_ int get_entity_count() const { return slots.size(); }
+    // Returns the position of an entity (a zero vector if it isn't registered).
+    Vector3 get_position(int64_t id) const;
+
+    // Appends the ids of the entities within a radius (on the floor plane) of a position.
+    void query_radius(const Vector3& position, float radius, Vector<int64_t>& r_ids) const;
+    // Appends the ids of the entities in the region containing a floor position (x, z).
+    void query_region(const Vector2& position, Vector<int64_t>& r_ids) const;
+};
+
+#endif
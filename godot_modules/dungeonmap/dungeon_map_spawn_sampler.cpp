@@ -0,0 +1,145 @@
+#include "dungeon_map_spawn_sampler.h"
+
+#include <math/math_funcs.h>
+
+// Candidates tried around a sample before it's retired.
+#define SAMPLE_CANDIDATES 30
+// Random tiles tried when sampling (re)starts before giving up.
+#define SAMPLE_SEED_ATTEMPTS 30
+
+int DungeonMapSpawnSampler::_get_cell(const Vector2& position) const
+{
+    // Tile y (and the cell y) grows towards -z.
+    int x = (int)Math::floor(position.x / cell_size);
+    int y = (int)Math::floor(position.y * -1.0f / cell_size);
+    if (x < 0 || y < 0 || x >= cells_x || y >= cells_y) {
+        return -1;
+    }
+    return y * cells_x + x;
+}
+
+Vector2 DungeonMapSpawnSampler::_get_random_position(int tile, DungeonMapRandom& rng) const
+{
+    float x = (tile % grid.width) + rng.randf();
+    float y = (tile / grid.width) + rng.randf();
+    return Vector2(x * tile_size, y * tile_size * -1.0f);
+}
+
+bool DungeonMapSpawnSampler::_is_valid(const Vector2& position) const
+{
+    int x = (int)Math::floor(position.x / tile_size);
+    int y = (int)Math::floor(position.y * -1.0f / tile_size);
+    if (!grid.is_walkable(x, y)) {
+        return false;
+    }
+    if (avoid_distance > 0.0f && position.distance_squared_to(avoid_position) < avoid_distance * avoid_distance) {
+        return false;
+    }
+    if (spacing <= 0.0f) {
+        return true;
+    }
+
+    // Cells are at least as large as the spacing, so only the surrounding ones can be too close.
+    int cell = _get_cell(position);
+    if (cell < 0) {
+        return false;
+    }
+    int cell_x = cell % cells_x;
+    int cell_y = cell / cells_x;
+    float spacing_squared = spacing * spacing;
+    const int* heads = cell_heads.ptr();
+    const int* next = sample_next.ptr();
+    const Vector2* points = samples.ptr();
+    for (int cy = MAX(cell_y - 1, 0); cy <= MIN(cell_y + 1, cells_y - 1); cy++) {
+        for (int cx = MAX(cell_x - 1, 0); cx <= MIN(cell_x + 1, cells_x - 1); cx++) {
+            for (int i = heads[cy * cells_x + cx]; i >= 0; i = next[i]) {
+                if (points[i].distance_squared_to(position) < spacing_squared) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void DungeonMapSpawnSampler::_add(const Vector2& position)
+{
+    int cell = _get_cell(position);
+    samples.push_back(position);
+    sample_next.push_back(cell_heads[cell]);
+    cell_heads.ptrw()[cell] = samples.size() - 1;
+}
+
+void DungeonMapSpawnSampler::sample(const int* valid_tiles, int valid_tile_count, int count, DungeonMapRandom& rng, Vector<Vector2>& r_samples)
+{
+    r_samples.clear();
+    if (valid_tile_count <= 0 || count <= 0 || tile_size <= 0.0f) {
+        return;
+    }
+
+    cells_x = (int)Math::ceil(grid.width * tile_size / cell_size);
+    cells_y = (int)Math::ceil(grid.height * tile_size / cell_size);
+    cell_heads.resize(cells_x * cells_y);
+    for (int i = 0; i < cell_heads.size(); i++) {
+        cell_heads.ptrw()[i] = -1;
+    }
+    sample_next.clear();
+    samples.clear();
+
+    // Samples that may still have room around them.
+    Vector<int> active;
+    while (samples.size() < count) {
+        if (active.size() == 0) {
+            // Start over from a random tile (the first sample, or a new area).
+            bool seeded = false;
+            for (int i = 0; i < SAMPLE_SEED_ATTEMPTS && !seeded; i++) {
+                Vector2 position = _get_random_position(valid_tiles[rng.rand(valid_tile_count)], rng);
+                if (_is_valid(position)) {
+                    _add(position);
+                    seeded = true;
+                }
+            }
+            if (!seeded) {
+                break;
+            }
+            // Without a spacing every sample is a fresh random tile.
+            if (spacing > 0.0f) {
+                active.push_back(samples.size() - 1);
+            }
+            continue;
+        }
+
+        // Try candidates in the ring between one and two spacings around an active sample.
+        int slot = rng.rand(active.size());
+        Vector2 center = samples[active[slot]];
+        bool found = false;
+        for (int i = 0; i < SAMPLE_CANDIDATES && !found; i++) {
+            float angle = rng.randf() * Math_PI * 2.0f;
+            float distance = spacing * (1.0f + rng.randf());
+            Vector2 position = center + Vector2(Math::cos(angle), Math::sin(angle)) * distance;
+            if (_is_valid(position)) {
+                _add(position);
+                active.push_back(samples.size() - 1);
+                found = true;
+            }
+        }
+        if (!found) {
+            active[slot] = active[active.size() - 1];
+            active.resize(active.size() - 1);
+        }
+    }
+
+    r_samples = samples;
+}
+
+DungeonMapSpawnSampler::DungeonMapSpawnSampler(const DungeonMapPathFinder::Grid& p_grid, float p_tile_size, float p_spacing, const Vector2& p_avoid_position, float p_avoid_distance)
+{
+    grid = p_grid;
+    tile_size = p_tile_size;
+    spacing = MAX(p_spacing, 0.0f);
+    avoid_position = p_avoid_position;
+    avoid_distance = p_avoid_distance;
+
+    // Small spacings share cells, which keeps the number of cells bounded.
+    cell_size = MAX(spacing, tile_size * 0.25f);
+}
@@ -0,0 +1,82 @@
+/**********************************************************
+ * Author:  Victor Holt
+ * The MIT License (MIT)
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ **********************************************************/
+
+#ifndef DUNGEON_MAP_SPAWN_SAMPLER_H
+#define DUNGEON_MAP_SPAWN_SAMPLER_H
+#include <typedefs.h>
+#include <vector.h>
+#include <math/math_2d.h>
+
+#include "dungeon_map_path_finder.h"
+#include "dungeon_map_random.h"
+
+// Poisson-disk sampling of positions on the walkable tiles (Bridson's
+// algorithm). Samples keep a minimum spacing from each other and from an
+// avoided position. Nearby samples are found through a grid of cells
+// holding linked lists of samples. Sampling restarts from a random walkable
+// tile whenever an area fills up, so disconnected areas get samples too.
+// Positions are on the floor plane (x, z).
+class DungeonMapSpawnSampler
+{
+    // Tiles to sample on.
+    DungeonMapPathFinder::Grid grid;
+    // Size of a single tile.
+    float tile_size;
+    // Minimum distance between samples.
+    float spacing;
+    // Position samples keep away from, and the distance they keep.
+    Vector2 avoid_position;
+    float avoid_distance;
+
+    // Size of an acceleration cell (at least the spacing, so neighbors are in the surrounding cells).
+    float cell_size;
+    // Number of cells along each axis.
+    int cells_x = 0;
+    int cells_y = 0;
+    // First sample in each cell (-1 if there's none).
+    Vector<int> cell_heads;
+    // Next sample in the same cell (-1 at the end).
+    Vector<int> sample_next;
+    // Samples taken so far.
+    Vector<Vector2> samples;
+
+    // Returns the cell of a position (-1 outside of the map).
+    int _get_cell(const Vector2& position) const;
+    // Returns a random position on a tile.
+    Vector2 _get_random_position(int tile, DungeonMapRandom& rng) const;
+    // Checks if a position is walkable and far enough from the samples and the avoided position.
+    bool _is_valid(const Vector2& position) const;
+    // Adds a sample.
+    void _add(const Vector2& position);
+
+public:
+    // Takes up to count samples (fewer if the tiles fill up). Tiles are
+    // picked from valid_tiles when sampling (re)starts.
+    void sample(const int* valid_tiles, int valid_tile_count, int count, DungeonMapRandom& rng, Vector<Vector2>& r_samples);
+
+    // Constructor.
+    DungeonMapSpawnSampler(const DungeonMapPathFinder::Grid& p_grid, float p_tile_size, float p_spacing, const Vector2& p_avoid_position, float p_avoid_distance);
+};
+
+#endif
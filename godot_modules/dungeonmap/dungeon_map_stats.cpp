@@ -0,0 +1,43 @@
+#include "dungeon_map_stats.h"
+
+void DungeonMapStats::reset()
+{
+    for (int i = 0; i < MAX_STAGES; i++) {
+        stage_usec[i] = 0;
+    }
+    tile_bytes = 0;
+    region_bytes = 0;
+    mesh_bytes = 0;
+    shape_bytes = 0;
+}
+
+Dictionary DungeonMapStats::to_dictionary() const
+{
+    static const char* stage_names[MAX_STAGES] = {
+        "walk_usec",
+        "connectivity_usec",
+        "tiles_usec",
+        "neighbors_usec",
+        "wall_distance_usec",
+        "floor_mesh_usec",
+        "edge_mesh_usec",
+        "mesh_commit_usec",
+        "collision_usec",
+        "navmesh_usec"
+    };
+
+    Dictionary stats;
+    uint64_t total = 0;
+    for (int i = 0; i < MAX_STAGES; i++) {
+        stats[stage_names[i]] = (int64_t)stage_usec[i];
+        total += stage_usec[i];
+    }
+    stats["total_usec"] = (int64_t)total;
+
+    stats["tile_bytes"] = (int64_t)tile_bytes;
+    stats["region_bytes"] = (int64_t)region_bytes;
+    stats["mesh_bytes"] = (int64_t)mesh_bytes;
+    stats["shape_bytes"] = (int64_t)shape_bytes;
+    stats["total_bytes"] = (int64_t)(tile_bytes + region_bytes + mesh_bytes + shape_bytes);
+    return stats;
+}
@@ -0,0 +1,96 @@
+/**********************************************************
+ * Author:  Victor Holt
+ * The MIT License (MIT)
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ **********************************************************/
+
+#ifndef DUNGEON_MAP_STATS_H
+#define DUNGEON_MAP_STATS_H
+#include <typedefs.h>
+#include <dictionary.h>
+#include <os/os.h>
+
+// Timings and memory counters for the last dungeon generation.
+struct DungeonMapStats
+{
+    // Timed stages of the generation pipeline.
+    enum Stage
+    {
+        STAGE_WALK = 0,
+        STAGE_CONNECTIVITY,
+        STAGE_TILES,
+        STAGE_NEIGHBORS,
+        STAGE_WALL_DISTANCE,
+        STAGE_FLOOR_MESH,
+        STAGE_EDGE_MESH,
+        STAGE_MESH_COMMIT,
+        STAGE_COLLISION,
+        STAGE_NAVMESH,
+
+        MAX_STAGES
+    };
+
+    // Time spent in each stage (microseconds).
+    uint64_t stage_usec[MAX_STAGES];
+    // Bytes used by the tile arrays and the occupancy grid.
+    uint64_t tile_bytes;
+    // Bytes used by the region pool.
+    uint64_t region_bytes;
+    // Bytes of committed mesh arrays (vertices, normals, uvs and indices).
+    uint64_t mesh_bytes;
+    // Bytes of collision shape faces.
+    uint64_t shape_bytes;
+
+    // Resets all counters.
+    void reset();
+    // Returns the counters as a Dictionary.
+    Dictionary to_dictionary() const;
+
+    // Constructor.
+    DungeonMapStats() { reset(); }
+};
+
+// Adds the time until the end of the scope to a counter. Does nothing
+// (besides a single branch) when the counter is NULL.
+class DungeonMapScopedTimer
+{
+    // Counter to add the time to.
+    uint64_t* counter;
+    // Start of the scope.
+    uint64_t start;
+
+public:
+    // Constructor.
+    _FORCE_INLINE_ DungeonMapScopedTimer(uint64_t* p_counter)
+    {
+        counter = p_counter;
+        start = counter ? OS::get_singleton()->get_ticks_usec() : 0;
+    }
+    // Destructor.
+    _FORCE_INLINE_ ~DungeonMapScopedTimer()
+    {
+        if (counter) {
+            *counter += OS::get_singleton()->get_ticks_usec() - start;
+        }
+    }
+};
+
+#endif
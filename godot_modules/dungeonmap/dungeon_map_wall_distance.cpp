@@ -0,0 +1,150 @@
+#include "dungeon_map_wall_distance.h"
+
+#include <string.h>
+
+// Returns the distance of a tile while the field is computed (tiles outside of the grid are walls).
+static _FORCE_INLINE_ int _get_distance(const uint8_t* distances, int width, int height, int x, int y)
+{
+    if (x < 0 || y < 0 || x >= width || y >= height) {
+        return 0;
+    }
+    return distances[y * width + x];
+}
+
+void DungeonMapWallDistance::_forward_row(const DungeonMapPathFinder::Grid& grid, uint8_t* field, int y, int min_x, int max_x) const
+{
+    // Walls start at zero, everything else starts out of reach.
+    for (int x = min_x; x <= max_x; x++) {
+        int index = y * width + x;
+        field[index] = grid.types[index] == 0 ? 0 : MAX_DISTANCE;
+    }
+
+    // The tile to the west and the three tiles to the south (rows are
+    // visited in increasing y).
+    for (int x = min_x; x <= max_x; x++) {
+        int index = y * width + x;
+        int distance = field[index];
+        if (distance == 0) {
+            continue;
+        }
+        distance = MIN(distance, _get_distance(field, width, height, x - 1, y) + STRAIGHT_DISTANCE);
+        distance = MIN(distance, _get_distance(field, width, height, x - 1, y - 1) + DIAGONAL_DISTANCE);
+        distance = MIN(distance, _get_distance(field, width, height, x, y - 1) + STRAIGHT_DISTANCE);
+        distance = MIN(distance, _get_distance(field, width, height, x + 1, y - 1) + DIAGONAL_DISTANCE);
+        field[index] = MIN(distance, MAX_DISTANCE);
+    }
+}
+
+void DungeonMapWallDistance::_backward_row(uint8_t* field, int y, int min_x, int max_x) const
+{
+    // The tile to the east and the three tiles to the north (rows are
+    // visited in decreasing y).
+    for (int x = max_x; x >= min_x; x--) {
+        int index = y * width + x;
+        int distance = field[index];
+        if (distance == 0) {
+            continue;
+        }
+        distance = MIN(distance, _get_distance(field, width, height, x + 1, y) + STRAIGHT_DISTANCE);
+        distance = MIN(distance, _get_distance(field, width, height, x + 1, y + 1) + DIAGONAL_DISTANCE);
+        distance = MIN(distance, _get_distance(field, width, height, x, y + 1) + STRAIGHT_DISTANCE);
+        distance = MIN(distance, _get_distance(field, width, height, x - 1, y + 1) + DIAGONAL_DISTANCE);
+        field[index] = distance;
+    }
+}
+
+void DungeonMapWallDistance::_count(const uint8_t* field, int min_x, int min_y, int max_x, int max_y, int amount)
+{
+    for (int y = min_y; y <= max_y; y++) {
+        const uint8_t* row = field + y * width;
+        for (int x = min_x; x <= max_x; x++) {
+            distance_counts[row[x]] += amount;
+        }
+    }
+}
+
+void DungeonMapWallDistance::_update_max_distance()
+{
+    // The largest distance still counted (a scan over at most 256 counts).
+    max_distance = MAX_DISTANCE;
+    while (max_distance > 0 && distance_counts[max_distance] == 0) {
+        max_distance--;
+    }
+}
+
+void DungeonMapWallDistance::build(const DungeonMapPathFinder::Grid& grid)
+{
+    begin_build(grid);
+    build_step(grid, height * 2);
+}
+
+void DungeonMapWallDistance::begin_build(const DungeonMapPathFinder::Grid& grid)
+{
+    width = grid.width;
+    height = grid.height;
+    max_distance = 0;
+    memset(distance_counts, 0, sizeof(distance_counts));
+    distances.resize(width * height);
+    build_row = 0;
+}
+
+bool DungeonMapWallDistance::build_step(const DungeonMapPathFinder::Grid& grid, int row_count)
+{
+    if (build_row >= height * 2) {
+        return true;
+    }
+
+    PoolVector<uint8_t>::Write w = distances.write();
+    uint8_t* field = w.ptr();
+
+    // Every row takes a forward step and, on the way back, a backward step.
+    for (int i = 0; i < row_count && build_row < height * 2; i++, build_row++) {
+        if (build_row < height) {
+            _forward_row(grid, field, build_row, 0, width - 1);
+        } else {
+            int y = height * 2 - 1 - build_row;
+            _backward_row(field, y, 0, width - 1);
+            _count(field, 0, y, width - 1, y, 1);
+        }
+    }
+
+    if (build_row < height * 2) {
+        return false;
+    }
+    _update_max_distance();
+    return true;
+}
+
+void DungeonMapWallDistance::update_tile(const DungeonMapPathFinder::Grid& grid, int x, int y)
+{
+    if (grid.width != width || grid.height != height) {
+        build(grid);
+        return;
+    }
+    if (x < 0 || y < 0 || x >= width || y >= height || !is_built()) {
+        return;
+    }
+
+    // A tile whose distance changes is closer to the changed tile than its
+    // old (or new) distance, and a step is at least STRAIGHT_DISTANCE units.
+    int radius = max_distance / STRAIGHT_DISTANCE + 1;
+    int min_x = MAX(x - radius, 0);
+    int min_y = MAX(y - radius, 0);
+    int max_x = MIN(x + radius, width - 1);
+    int max_y = MIN(y + radius, height - 1);
+
+    // Tiles outside of the window keep their distances and seed the tiles
+    // inside of it. Only the window's counts change, which keeps
+    // max_distance exact.
+    PoolVector<uint8_t>::Write w = distances.write();
+    uint8_t* field = w.ptr();
+    _count(field, min_x, min_y, max_x, max_y, -1);
+    for (int row = min_y; row <= max_y; row++) {
+        _forward_row(grid, field, row, min_x, max_x);
+    }
+    for (int row = max_y; row >= min_y; row--) {
+        _backward_row(field, row, min_x, max_x);
+    }
+    _count(field, min_x, min_y, max_x, max_y, 1);
+    _update_max_distance();
+}
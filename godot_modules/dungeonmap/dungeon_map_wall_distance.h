@@ -0,0 +1,96 @@
+/**********************************************************
+ * Author:  Victor Holt
+ * The MIT License (MIT)
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ **********************************************************/
+
+#ifndef DUNGEON_MAP_WALL_DISTANCE_H
+#define DUNGEON_MAP_WALL_DISTANCE_H
+#include <typedefs.h>
+#include <pool_vector.h>
+
+#include "dungeon_map_path_finder.h"
+
+// Distance from every tile to the nearest wall (an empty tile, or the map
+// border) as a 3-4 chamfer distance transform: 3 units per straight step,
+// 4 per diagonal step. The field is built with one forward and one backward
+// raster pass, and stored as a byte per tile, saturating at 255 (85 tiles).
+// The passes can be spread over several steps of a few rows each. After a
+// tile changes, only a window around it is recomputed.
+class DungeonMapWallDistance
+{
+    // Distance of each tile (row-major, chamfer units).
+    PoolVector<uint8_t> distances;
+    // Size of the field in tiles.
+    int width = 0;
+    int height = 0;
+    // Largest distance in the field, which bounds the tiles a change can affect.
+    int max_distance = 0;
+    // Number of tiles at each distance (one count per byte value), so the
+    // largest one is known after a local update without a pass over the field.
+    int distance_counts[256];
+
+    // Next row of a build in steps: the forward pass rows come first, then
+    // the backward pass rows (the build is done at twice the height).
+    int build_row = 0;
+
+    // Resets a row of a window and runs the forward pass over it.
+    void _forward_row(const DungeonMapPathFinder::Grid& grid, uint8_t* field, int y, int min_x, int max_x) const;
+    // Runs the backward pass over a row of a window.
+    void _backward_row(uint8_t* field, int y, int min_x, int max_x) const;
+    // Adds the distances of a window to the counts (or removes them).
+    void _count(const uint8_t* field, int min_x, int min_y, int max_x, int max_y, int amount);
+    // Sets max_distance to the largest distance still counted.
+    void _update_max_distance();
+
+public:
+    // Units of a straight and a diagonal step.
+    static const int STRAIGHT_DISTANCE = 3;
+    static const int DIAGONAL_DISTANCE = 4;
+    // Largest stored distance.
+    static const int MAX_DISTANCE = 255;
+
+    // Rebuilds the whole field for a grid.
+    void build(const DungeonMapPathFinder::Grid& grid);
+    // Starts rebuilding the field for a grid in steps.
+    void begin_build(const DungeonMapPathFinder::Grid& grid);
+    // Runs up to row_count more rows of the passes of a build started with
+    // begin_build (each row is visited once per pass, so a build takes twice
+    // the height). Returns true once the field is complete.
+    bool build_step(const DungeonMapPathFinder::Grid& grid, int row_count);
+    // Checks if the field is complete.
+    _FORCE_INLINE_ bool is_built() const { return build_row >= height * 2; }
+    // Updates the field after a single tile changed (ignored while a build
+    // in steps is unfinished).
+    void update_tile(const DungeonMapPathFinder::Grid& grid, int x, int y);
+
+    // Returns the distance of a tile in chamfer units (0 for walls and tiles outside of the field).
+    _FORCE_INLINE_ uint8_t get_distance(int index) const
+    {
+        return (index >= 0 && index < width * height) ? distances[index] : 0;
+    }
+    // Returns the number of bytes used by the field.
+    _FORCE_INLINE_ int get_memory_usage() const { return distances.size(); }
+    // Returns the field, one byte per tile (shares the storage until either copy is written).
+    _FORCE_INLINE_ PoolVector<uint8_t> get_distances() const { return distances; }
+};
+
+#endif
@@ -6,6 +6,7 @@
 #include "register_types.h"
 #include "dungeon_map.h"
 #include "dungeon_map_debug_renderer.h"
+#include "dungeon_map_benchmark.h"
 #ifndef _3D_DISABLED
 #include "class_db.h"
 #endif
@@ -15,6 +16,7 @@ void register_dungeonmap_types()
 #ifndef _3D_DISABLED
 	ClassDB::register_class<DungeonMap>();
 	ClassDB::register_class<DungeonMapDebugRenderer>();
+	ClassDB::register_class<DungeonMapBenchmark>();
 #ifdef TOOLS_ENABLED
 #endif
 #endif
@@ -0,0 +1,68 @@
+extends SceneTree
+
+# Benchmarks the DungeonMap generation pipeline and prints the results as JSON.
+#
+#   godot --no-window -s scripts/Benchmark.gd [--iterations=3] [--output=bench.json]
+#
+# Every configuration is run for a number of iterations and the fastest
+# time of each phase is kept.
+
+const SEEDS = [1023321012, 345432342352, 7]
+const REGION_SIZES = [4, 8, 16]
+const TILES_PER_REGION = [4, 8]
+const FLOOR_SIZES = [4, 8]
+const MAX_FLOORS = [500, 1500, 5000]
+const MERGE_MESHES = [false, true]
+
+func _init():
+	var iterations = 3
+	var output_path = ""
+	for arg in OS.get_cmdline_args():
+		if arg.begins_with("--iterations="):
+			iterations = max(1, int(arg.split("=")[1]))
+		elif arg.begins_with("--output="):
+			output_path = arg.split("=")[1]
+	
+	var benchmark = DungeonMapBenchmark.new()
+	var results = []
+	for seed_value in SEEDS:
+		for region_size in REGION_SIZES:
+			for tiles_per_region in TILES_PER_REGION:
+				for floor_size in FLOOR_SIZES:
+					for max_floors in MAX_FLOORS:
+						for merge_meshes in MERGE_MESHES:
+							var config = {
+								"seed": seed_value,
+								"region_size": region_size,
+								"tiles_per_region": tiles_per_region,
+								"floor_size": floor_size,
+								"max_floors": max_floors,
+								"merge_floor_tiles": merge_meshes,
+								"merge_wall_edges": merge_meshes
+							}
+							results.append(_run_config(benchmark, config, iterations))
+	
+	var report = {
+		"engine": Engine.get_version_info(),
+		"processor_count": OS.get_processor_count(),
+		"iterations": iterations,
+		"results": results
+	}
+	var json = to_json(report)
+	if output_path != "":
+		var file = File.new()
+		if file.open(output_path, File.WRITE) == OK:
+			file.store_string(json)
+			file.close()
+		else:
+			printerr("Unable to write benchmark results to " + output_path)
+	print(json)
+	quit()
+
+func _run_config(benchmark, config, iterations):
+	var best = benchmark.run(config)
+	for i in range(iterations - 1):
+		var result = benchmark.run(config)
+		for phase in result["phases"]:
+			best["phases"][phase] = min(best["phases"][phase], result["phases"][phase])
+	return best
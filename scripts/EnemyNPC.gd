@@ -4,12 +4,26 @@ var has_target = false
 var health = 100
 var dead = false
 
+# Movement speed (units per second).
+const SPEED = 3.0
+# Distance at which the player is noticed.
+const CHASE_RADIUS = 30.0
+# Entity id the spawner registers the player with.
+const PLAYER_ENTITY = 0
+
+# Entity id in the dungeon map (set by the spawner).
+var entity_id = -1
+onready var dungeon_map = get_node("../../DungeonMap")
+onready var player = get_node("../../Player")
+
 func _ready():
 	pass
 		
 func _physics_process(delta):
 	_check_hit()
 	_patrol(delta)
+	if !dead and entity_id >= 0:
+		dungeon_map.update_entity(entity_id, translation)
 				
 func _check_hit():
 	if dead:
@@ -26,31 +40,34 @@ func _check_hit():
 				hide()
 				translation = Vector3(-9999,-9999,-9999)				
 				dead = true
+				dungeon_map.remove_entity(entity_id)
 				return
 
 func _patrol(delta):
 	if dead:
 		return
 	
-	var navigation = get_node("../../Navigation")
-	var player = get_node("../../Player")
-	var path_to_player = PoolVector3Array()
+	if !dungeon_map or !player:
+		return
 	
-	if player and translation.distance_to(player.translation) > 30:
+	# Only the entities near this enemy are checked for the player.
+	if !(PLAYER_ENTITY in dungeon_map.get_entities_in_radius(translation, CHASE_RADIUS)):
 		return
 	
-	if navigation and player:
-		path_to_player = navigation.get_simple_path(translation, player.translation, false)
-		if path_to_player.size() == 0:
-			return
-		has_target = true
-		
-	if !has_target:
+	# The spawner keeps the flow field pointed at the player.
+	var distance = dungeon_map.get_flow_distance(translation)
+	if distance < 0:
 		return
-		
-	var next_pos = Vector3()
-	next_pos = translation.linear_interpolate(path_to_player[path_to_player.size() - 1], 0.5 * delta)
-	translation = next_pos
+	has_target = true
+	
+	var direction = dungeon_map.get_flow_direction(translation)
+	if distance == 0:
+		# Same tile as the player, head straight for them.
+		direction = player.translation - translation
+		direction.y = 0
+		direction = direction.normalized()
+	
+	translation += direction * SPEED * delta
 	translation.y = 0.51
 	
 #func _projectile_hit_event(projectile, body):
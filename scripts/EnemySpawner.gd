@@ -5,24 +5,48 @@ var npc_dictionary = Dictionary()
 onready var npc_enemy_prefab = preload("res://prefabs/EnemyNPC.scn")
 onready var dungeon_map = get_parent().get_node("DungeonMap")
 onready var level_gen_ui = get_node("../GUI/LevelGenMapUI")
+onready var player = get_parent().get_node("Player")
+
+# Entity id of the player in the dungeon map (enemies use 1 and up).
+const PLAYER_ENTITY = 0
+# Number of enemies spawned.
+const ENEMY_COUNT = 20
+# Minimum distance between two enemies.
+const SPAWN_SPACING = 12.0
+# Minimum distance between an enemy and the player.
+const SPAWN_PLAYER_DISTANCE = 24.0
 
 
 func _ready():
 	level_gen_ui.connect("level_image_generation_complete", self, "_generate_map_complete")
 	_load_enemies()
 	
+func _physics_process(delta):
+	# Every enemy follows the same flow field towards the player, it's only
+	# rebuilt when the player moves to another tile.
+	if player:
+		dungeon_map.set_flow_target(player.translation)
+		dungeon_map.update_entity(PLAYER_ENTITY, player.translation)
+	
 func _generate_map_complete():
 	_load_enemies()
 	
 func _load_enemies():
-	if npc_dictionary.size() > 0:
-		for i in range(20):
-			npc_dictionary[i].queue_free()
+	for i in npc_dictionary:
+		dungeon_map.remove_entity(npc_dictionary[i].entity_id)
+		npc_dictionary[i].queue_free()
 	npc_dictionary.clear()
 	
-	for i in range(20):
-		var rand_loc = dungeon_map.get_random_map_location()
+	# Spread the enemies out and away from the player in a single call.
+	var player_loc = Vector2()
+	if player:
+		player_loc = Vector2(player.translation.x, player.translation.z)
+	var spawn_points = dungeon_map.sample_spawn_points(ENEMY_COUNT, SPAWN_SPACING, player_loc, SPAWN_PLAYER_DISTANCE, dungeon_map.get_dungeon_seed())
+	for i in range(spawn_points.size()):
+		var spawn_loc = spawn_points[i]
 		var npc_instance = npc_enemy_prefab.instance()
-		npc_instance.translation = Vector3(rand_loc.x, 0.51, rand_loc.y)
+		npc_instance.translation = Vector3(spawn_loc.x, 0.51, spawn_loc.y)
+		npc_instance.entity_id = PLAYER_ENTITY + 1 + i
+		dungeon_map.update_entity(npc_instance.entity_id, npc_instance.translation)
 		add_child(npc_instance)
 		npc_dictionary[i] = npc_instance
\ No newline at end of file
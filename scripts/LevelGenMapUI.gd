@@ -13,7 +13,17 @@ var last_pos = Vector2()
 
 func _ready():
 	set_texture(dungeon_map.get_map_texture())
+	
+	# Keep regeneration under 2ms per frame and keep the
+	# current level around until the next one is ready.
+	dungeon_map.set_incremental_apply(true)
+	dungeon_map.set_apply_budget_usec(2000)
+	dungeon_map.set_double_buffered(true)
+	
 	generate_button.connect("pressed", self, "_generate_map")
+	dungeon_map.connect("dungeon_map_generation_progress", self, "_generation_progress")
+	dungeon_map.connect("dungeon_map_apply_completed", self, "_generation_completed")
+	dungeon_map.connect("dungeon_map_generation_canceled", self, "_generation_canceled")
 	
 	# Update the label with the seed.
 	get_parent().get_node("GameStatusLabel").set_text("Seed: " + String(dungeon_map.get_dungeon_seed()))
@@ -58,12 +68,24 @@ func _generate_map():
 	# Update generating flag and reset the map.
 	is_generating = true
 	
-	# Update the status label.
+	# Generate the map on a worker thread, we'll finish up once
+	# the dungeon map lets us know it's been applied.
 	dungeon_map.mark_dirty()
-	dungeon_map.generate_map_image()
-	dungeon_map.apply()
+	dungeon_map.generate_async()
+	
+func _generation_progress(phase, fraction):
+	get_parent().get_node("GameStatusLabel").set_text("Generating: " + String(int(fraction * 100)) + "%")
+	
+func _generation_canceled():
+	is_generating = false
+	get_parent().get_node("GameStatusLabel").set_text("Canceled")
 	
+func _generation_completed():
+	if !is_generating:
+		return
+		
 	is_generating = false
+	get_parent().get_node("GameStatusLabel").set_text("Seed: " + String(dungeon_map.get_dungeon_seed()))
 	
 	# Update the map texture.
 	set_texture(dungeon_map.get_map_texture())